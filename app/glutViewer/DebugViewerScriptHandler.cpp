@@ -25,6 +25,8 @@ DebugViewerScriptHandler::DebugViewerScriptHandler(OSPModel    model,
   ss << "resetView()           --> reset camera view" << endl;
   ss << "printViewport()       --> print view params in the console" << endl;
   ss << "screenshot(filename)  --> save a screenshot (adds '.ppm')" << endl;
+  ss << "toggleAnimation()     --> play/pause an animated model" << endl;
+  ss << "setAnimationFrameRate(fps) --> set animation playback speed" << endl;
 
   m_helpText += ss.str();
 }
@@ -63,12 +65,24 @@ void DebugViewerScriptHandler::registerScriptFunctions()
     m_viewer->saveScreenshot(name);
   };
 
+  // toggleAnimation()
+  auto toggleAnimation = [&]() {
+    m_viewer->toggleAnimation();
+  };
+
+  // setAnimationFrameRate()
+  auto setAnimationFrameRate = [&](float fps) {
+    m_viewer->setAnimationFrameRate(fps);
+  };
+
   chai.add(chaiscript::fun(setRenderer),      "setRenderer"     );
   chai.add(chaiscript::fun(refresh),          "refresh"         );
   chai.add(chaiscript::fun(toggleFullscreen), "toggleFullscreen");
   chai.add(chaiscript::fun(resetView),        "resetView"       );
   chai.add(chaiscript::fun(printViewport),    "printViewport"   );
   chai.add(chaiscript::fun(screenshot),       "screenshot"      );
+  chai.add(chaiscript::fun(toggleAnimation),  "toggleAnimation" );
+  chai.add(chaiscript::fun(setAnimationFrameRate), "setAnimationFrameRate");
 }
 
 }// namespace ospray
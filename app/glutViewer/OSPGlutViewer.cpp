@@ -46,7 +46,8 @@ OSPGlutViewer::OSPGlutViewer(const box3f &worldBounds, cpp::Model model,
     m_queuedRenderer(nullptr),
     m_alwaysRedraw(true),
     m_accumID(-1),
-    m_fullScreen(false)
+    m_fullScreen(false),
+    m_usingLOD(false)
 {
   setWorldBounds(worldBounds);
 
@@ -106,6 +107,28 @@ void OSPGlutViewer::saveScreenshot(const std::string &basename)
        << endl;
 }
 
+void OSPGlutViewer::setAnimation(std::shared_ptr<TriangleMeshAnimation> animation)
+{
+  m_animation = animation;
+}
+
+void OSPGlutViewer::toggleAnimation()
+{
+  if (m_animation)
+    m_animation->setPlaying(!m_animation->playing());
+}
+
+void OSPGlutViewer::setAnimationFrameRate(float framesPerSecond)
+{
+  if (m_animation)
+    m_animation->setFrameRate(framesPerSecond);
+}
+
+void OSPGlutViewer::setLOD(std::shared_ptr<TriangleMeshLOD> lod)
+{
+  m_lod = lod;
+}
+
 void OSPGlutViewer::reshape(const vec2i &newSize)
 {
   Glut3DWidget::reshape(newSize);
@@ -166,6 +189,17 @@ void OSPGlutViewer::keypress(char key, const vec2i &where)
   case 'p':
     printViewport();
     break;
+  case ' ':
+    toggleAnimation();
+    break;
+  case '[':
+    if (m_animation)
+      setAnimationFrameRate(m_animation->frameRate() / 2.f);
+    break;
+  case ']':
+    if (m_animation)
+      setAnimationFrameRate(m_animation->frameRate() * 2.f);
+    break;
   default:
     Glut3DWidget::keypress(key,where);
   }
@@ -213,6 +247,12 @@ void OSPGlutViewer::display()
   // NOTE: consume a new renderer if one has been queued by another thread
   switchRenderers();
 
+  // NOTE: show the next time step if the animation has it ready
+  advanceAnimation();
+
+  // NOTE: render the simplified proxy while the camera moves
+  switchLOD();
+
   if (m_resetAccum) {
     m_fb.clear(OSP_FB_ACCUM);
     m_resetAccum = false;
@@ -277,4 +317,46 @@ void OSPGlutViewer::switchRenderers()
   }
 }
 
+void OSPGlutViewer::advanceAnimation()
+{
+  if (!m_animation) return;
+
+  cpp::Model model;
+  if (m_animation->update(model)) {
+    m_model = model;
+    useModel(m_model);
+  }
+}
+
+void OSPGlutViewer::switchLOD()
+{
+  // the proxy only stands in for the initial scene, not animation frames;
+  // update() uploads it here once its simplification is done
+  if (!m_lod || m_animation || !m_lod->update()) return;
+
+  const auto now = std::chrono::steady_clock::now();
+  if (viewPort.modified)
+    m_lastCameraMove = now;
+
+  // keep the proxy for a moment after the last move, so a pause between
+  // two mouse motion events doesn't switch back and forth
+  const bool moving = now - m_lastCameraMove < std::chrono::milliseconds(250);
+  if (moving != m_usingLOD) {
+    m_usingLOD = moving;
+    useModel(m_usingLOD ? m_lod->model() : m_model);
+  }
+
+  // make sure we get back to the full model once the camera stops
+  if (m_usingLOD)
+    forceRedraw();
+}
+
+void OSPGlutViewer::useModel(cpp::Model model)
+{
+  m_renderer.set("world", model);
+  m_renderer.set("model", model);
+  m_renderer.commit();
+  m_fb.clear(OSP_FB_ACCUM);
+}
+
 }// namepace ospray
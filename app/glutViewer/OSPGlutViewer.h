@@ -17,12 +17,18 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <mutex>
 
 // viewer widget
 #include "common/widgets/glut3D.h"
 // mini scene graph for loading the model
 #include "common/miniSG/miniSG.h"
+// streamed time steps of animated triangle meshes
+#include "common/commandline/SceneParser/trianglemesh/TriangleMeshAnimation.h"
+// simplified proxies for interactive navigation
+#include "common/commandline/SceneParser/trianglemesh/TriangleMeshLOD.h"
 
 #include <ospray_cpp/Camera.h>
 #include <ospray_cpp/Model.h>
@@ -47,6 +53,12 @@ public:
   void printViewport();
   void saveScreenshot(const std::string &basename);
 
+  void setAnimation(std::shared_ptr<TriangleMeshAnimation> animation);
+  void toggleAnimation();
+  void setAnimationFrameRate(float framesPerSecond);
+
+  void setLOD(std::shared_ptr<TriangleMeshLOD> lod);
+
 protected:
 
   virtual void reshape(const ospcommon::vec2i &newSize) override;
@@ -59,6 +71,9 @@ private:
   void display() override;
 
   void switchRenderers();
+  void advanceAnimation();
+  void switchLOD();
+  void useModel(cpp::Model model);
 
   // Data //
 
@@ -80,6 +95,12 @@ private:
   glut3D::Glut3DWidget::ViewPort m_viewPort;
 
   std::atomic<bool> m_resetAccum;
+
+  std::shared_ptr<TriangleMeshAnimation> m_animation;
+
+  std::shared_ptr<TriangleMeshLOD> m_lod;
+  bool m_usingLOD;
+  std::chrono::steady_clock::time_point m_lastCameraMove;
 };
 
 }// namespace ospray
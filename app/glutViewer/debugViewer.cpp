@@ -32,24 +32,53 @@ std::string scriptFileFromCommandLine(int ac, const char **&av)
   return scriptFileName;
 }
 
+std::shared_ptr<TriangleMeshAnimation>
+animationFromCommandLine(int ac, const char **&av,
+                         ospray::cpp::Renderer renderer)
+{
+  std::vector<std::string> timeSteps;
+  float frameRate = 10.f;
+
+  for (int i = 1; i < ac; i++) {
+    const std::string arg = av[i];
+    if (arg == "--animation-fps") {
+      frameRate = atof(av[++i]);
+    } else if (ospcommon::FileName(arg).ext() == "astl") {
+      timeSteps = ospray::miniSG::listSTLAnimation(arg);
+    }
+  }
+
+  if (timeSteps.size() < 2)
+    return nullptr;
+
+  auto animation = std::make_shared<TriangleMeshAnimation>(renderer, timeSteps,
+                                                           ac, av);
+  animation->setFrameRate(frameRate);
+  return animation;
+}
+
 int main(int ac, const char **av)
 {
   ospInit(&ac,av);
   ospray::glut3D::initGLUT(&ac,av);
 
-  auto ospObjs = parseWithDefaultParsers(ac, av);
+  std::shared_ptr<TriangleMeshLOD> lod;
+  auto ospObjs = parseWithDefaultParsers(ac, av, &lod);
 
   ospcommon::box3f      bbox;
   ospray::cpp::Model    model;
   ospray::cpp::Renderer renderer;
   ospray::cpp::Camera   camera;
+  SceneHostData         hostData; // lives as long as the viewer runs
 
-  std::tie(bbox, model, renderer, camera) = ospObjs;
+  std::tie(bbox, model, renderer, camera, hostData) = ospObjs;
 
   auto scriptFileName = scriptFileFromCommandLine(ac, av);
 
   ospray::ScriptedOSPGlutViewer window(bbox, model, renderer,
                                        camera, scriptFileName);
+  window.setAnimation(animationFromCommandLine(ac, av, renderer));
+  window.setLOD(lod);
   window.create("ospDebugViewer: OSPRay Mini-Scene Graph test viewer");
 
   ospray::glut3D::runGLUT();
@@ -100,6 +100,7 @@ MainWindow::openFile(QString fileName)
   renderer.set("model", model);
   renderer.commit();
   m_loadedModels.push_back({file.substr(file.find_last_of('/')+1), model});
+  m_loadedHostData.push_back(msParser.hostData());
 
   return {renderer, msParser.bbox()};
 }
@@ -25,6 +25,8 @@
 #include <ospcommon/box.h>
 #include <ospcommon/common.h>
 
+#include "common/commandline/SceneParser/SceneParser.h"
+
 class MainWindow : public QMainWindow
 {
   Q_OBJECT
@@ -57,5 +59,8 @@ private:
 
   using NamedModel = std::pair<std::string, ospray::cpp::Model>;
   std::vector<NamedModel> m_loadedModels;
+
+  // memory the loaded models render from directly
+  std::vector<SceneHostData> m_loadedHostData;
 };
 
@@ -14,6 +14,9 @@ BENCHMARK_F(OSPRayFixture, test1, 1, 100)
   renderer->renderFrame(*fb, OSP_FB_COLOR | OSP_FB_ACCUM);
 }
 
+// memory the benchmarked model renders from directly (eg, mapped files)
+static SceneHostData sceneHostData;
+
 // NOTE(jda) - Implement make_unique() as it didn't show up until C++14...
 template<typename T, typename ...Args>
 std::unique_ptr<T> make_unique(Args&& ...args)
@@ -84,6 +87,54 @@ void printUsageAndExit()
   cout << "    -vu | --up --> Specify the camera up as: ux uy uz " << endl;
 
 
+  cout << endl;
+  cout << "**triangle mesh options**" << endl;
+
+  cout << endl;
+  cout << "    --roi --> Only load meshes overlapping the box given as:"
+       << " minx miny minz maxx maxy maxz" << endl;
+
+  cout << endl;
+  cout << "    --spatial-reorder --> Sort triangles and vertices of each mesh"
+       << " along a Morton curve before upload." << endl;
+  cout << "                          Run with and without to compare frame"
+       << " times." << endl;
+
+  cout << endl;
+  cout << "    --detect-instances --> Replace meshes that are identical or"
+       << " translated copies" << endl;
+  cout << "                           of each other by instances of a"
+       << " single mesh." << endl;
+
+  cout << endl;
+  cout << "    --generate-normals --> Compute smooth vertex normals for meshes"
+       << " that have none (--angle-weighted-normals: weight by angle"
+       << " instead of area)." << endl;
+
+  cout << endl;
+  cout << "    --batch-meshes --> Merge non-instanced meshes with fewer than"
+       << " the given number of triangles into batches of up to that many."
+       << endl;
+
+  cout << endl;
+  cout << "    --import-threads --> Number of scene files to import at once"
+       << " (default: one per core)." << endl;
+
+  cout << endl;
+  cout << "    --import-io-limit --> Number of import threads reading from"
+       << " disk at once; parsing isn't limited (default: 4)." << endl;
+
+  cout << endl;
+  cout << "    --texture-budget --> Downsample textures until they fit into"
+       << " the given number of MB." << endl;
+
+  cout << endl;
+  cout << "    --upload-mode --> How mesh arrays get to OSPRay: 'copy'"
+       << " (default), 'share' (no copy, host arrays stay alive), or"
+       << " 'release' (host copy freed after each mesh's commit, so peak"
+       << " host memory stays at about one copy of the scene)." << endl;
+
+
   cout << endl;
   cout << "**volume rendering options**" << endl;
 
@@ -146,7 +197,8 @@ void parseCommandLine(int argc, const char *argv[])
   std::tie(bbox,
            *OSPRayFixture::model,
            *OSPRayFixture::renderer,
-           *OSPRayFixture::camera) = ospObjs;
+           *OSPRayFixture::camera,
+           sceneHostData) = ospObjs;
 
   float width  = OSPRayFixture::width;
   float height = OSPRayFixture::height;
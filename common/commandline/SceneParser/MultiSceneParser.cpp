@@ -24,9 +24,146 @@
 #include "trianglemesh/TriangleMeshSceneParser.h"
 #include "volume/VolumeSceneParser.h"
 
+#include <ospcommon/AffineSpace.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
 using namespace ospray;
 using namespace ospcommon;
 
+// Scene file registry ////////////////////////////////////////////////////////
+
+enum SceneParserType
+{
+  TRIANGLE_MESH_PARSER,
+  TACHYON_PARSER,
+  PARTICLE_PARSER,
+  STREAMLINE_PARSER,
+  VOLUME_PARSER,
+  NUM_SCENE_PARSERS
+};
+
+/*! name of the root element of an xml file, or an empty string if the
+    file can't be read (or doesn't look like xml) */
+static std::string xmlRootElement(const FileName &fileName)
+{
+  FILE *file = fopen(fileName.c_str(), "rb");
+  if (!file)
+    return "";
+
+  char head[4096];
+  const size_t size = fread(head, 1, sizeof(head) - 1, file);
+  fclose(file);
+  head[size] = 0;
+
+  // skip the xml declaration, processing instructions, comments and
+  // doctype, up to the first real element
+  const char *s = head;
+  while ((s = strchr(s, '<')) != nullptr) {
+    if (s[1] == '?') {
+      s = strstr(s, "?>");
+    } else if (!strncmp(s, "<!--", 4)) {
+      s = strstr(s, "-->");
+    } else if (s[1] == '!') {
+      s = strchr(s, '>');
+    } else {
+      const char *begin = s + 1;
+      const char *end   = begin;
+      while (*end && !strchr(" \t\r\n/>", *end))
+        end++;
+      return std::string(begin, end);
+    }
+    if (!s)
+      break;
+    s++;
+  }
+
+  return "";
+}
+
+static bool isUintahTimestep(const FileName &fileName)
+{
+  return xmlRootElement(fileName) == "Uintah_timestep";
+}
+
+struct SceneFileType
+{
+  const char      *ext;    // file extension, without the '.'
+  SceneParserType  parser; // parser that loads files of this type
+  // optional check of the file's content, for extensions that are used
+  // by more than one format; the first matching entry claims the file
+  bool (*sniff)(const FileName &);
+};
+
+static const SceneFileType sceneFileTypes[] = {
+  {"xml",     PARTICLE_PARSER,      isUintahTimestep},
+  {"xml",     TRIANGLE_MESH_PARSER, nullptr}, // RIVL
+  {"stl",     TRIANGLE_MESH_PARSER, nullptr},
+  {"astl",    TRIANGLE_MESH_PARSER, nullptr},
+  {"msg",     TRIANGLE_MESH_PARSER, nullptr},
+  {"tri",     TRIANGLE_MESH_PARSER, nullptr},
+  {"obj",     TRIANGLE_MESH_PARSER, nullptr},
+  {"hbp",     TRIANGLE_MESH_PARSER, nullptr},
+  {"x3d",     TRIANGLE_MESH_PARSER, nullptr},
+  {"tachy",   TACHYON_PARSER,       nullptr},
+  {"xyz",     PARTICLE_PARSER,      nullptr},
+  {"xyz2",    PARTICLE_PARSER,      nullptr},
+  {"osx",     STREAMLINE_PARSER,    nullptr},
+  {"pnt",     STREAMLINE_PARSER,    nullptr},
+  {"swc",     STREAMLINE_PARSER,    nullptr},
+  {"pntlist", STREAMLINE_PARSER,    nullptr},
+  {"slraw",   STREAMLINE_PARSER,    nullptr},
+  {"sv",      STREAMLINE_PARSER,    nullptr},
+  {"osp",     VOLUME_PARSER,        nullptr},
+};
+
+/*! the parser that claims the given command line argument, or -1 if the
+    argument isn't a scene file (i.e., it's an option or option value,
+    which all parsers get to see) */
+static int claimingParser(const std::string &arg)
+{
+  if (arg == "___CUBE_TEST___")
+    return PARTICLE_PARSER;
+
+  const FileName fileName = arg;
+  const std::string ext = fileName.ext();
+  if (ext.empty())
+    return -1;
+
+  for (const auto &type : sceneFileTypes) {
+    if (ext == type.ext && (!type.sniff || type.sniff(fileName)))
+      return type.parser;
+  }
+
+  return -1;
+}
+
+static std::unique_ptr<SceneParser>
+createParser(SceneParserType type, cpp::Renderer renderer)
+{
+  switch (type) {
+  case TRIANGLE_MESH_PARSER:
+    return std::unique_ptr<SceneParser>(new TriangleMeshSceneParser(renderer));
+#ifdef OSPRAY_TACHYON_SUPPORT
+  case TACHYON_PARSER:
+    return std::unique_ptr<SceneParser>(new TachyonSceneParser(renderer));
+#endif
+  case PARTICLE_PARSER:
+    return std::unique_ptr<SceneParser>(new ParticleSceneParser(renderer));
+  case STREAMLINE_PARSER:
+    return std::unique_ptr<SceneParser>(new StreamLineSceneParser(renderer));
+  case VOLUME_PARSER:
+    return std::unique_ptr<SceneParser>(new VolumeSceneParser(renderer));
+  default:
+    return nullptr;
+  }
+}
+
+// MultiSceneParser definitions ///////////////////////////////////////////////
+
 MultiSceneParser::MultiSceneParser(cpp::Renderer renderer) :
   m_renderer(renderer)
 {
@@ -34,43 +171,92 @@ MultiSceneParser::MultiSceneParser(cpp::Renderer renderer) :
 
 bool MultiSceneParser::parse(int ac, const char **&av)
 {
-  TriangleMeshSceneParser triangleMeshParser(m_renderer);
-#ifdef OSPRAY_TACHYON_SUPPORT
-  TachyonSceneParser      tachyonParser(m_renderer);
-#endif
-  ParticleSceneParser     particleParser(m_renderer);
-  StreamLineSceneParser   streamlineParser(m_renderer);
-  VolumeSceneParser       volumeParser(m_renderer);
+  // claim each scene file for exactly one parser, before anything gets
+  // loaded; each parser then sees all options, but only its own files
+  std::vector<int> claimedBy(ac, -1);
+  bool parserHasFiles[NUM_SCENE_PARSERS] = {false};
 
-  bool gotTriangleMeshScene = triangleMeshParser.parse(ac, av);
-#ifdef OSPRAY_TACHYON_SUPPORT
-  bool gotTachyonScene      = tachyonParser.parse(ac, av);
+  for (int i = 1; i < ac; i++) {
+    claimedBy[i] = claimingParser(av[i]);
+    if (claimedBy[i] >= 0)
+      parserHasFiles[claimedBy[i]] = true;
+  }
+
+#ifndef OSPRAY_TACHYON_SUPPORT
+  if (parserHasFiles[TACHYON_PARSER]) {
+    std::cout << "#osp:scene: tachyon support is not enabled, ignoring"
+              << " .tachy files" << std::endl;
+    parserHasFiles[TACHYON_PARSER] = false;
+  }
 #endif
-  bool gotPartileScene      = particleParser.parse(ac, av);
-  bool gotStreamLineScene   = streamlineParser.parse(ac, av);
-  bool gotVolumeScene       = volumeParser.parse(ac, av);
 
-  SceneParser *parser = nullptr;
+  std::vector<std::unique_ptr<SceneParser>> parsers;
 
-  if (gotTriangleMeshScene)
-    parser = &triangleMeshParser;
-#ifdef OSPRAY_TACHYON_SUPPORT
-  else if (gotTachyonScene)
-    parser = &tachyonParser;
-#endif
-  else if (gotPartileScene)
-    parser = &particleParser;
-  else if (gotStreamLineScene)
-    parser = &streamlineParser;
-  else if (gotVolumeScene)
-    parser = &volumeParser;
-
-  if (parser) {
-    m_model = parser->model();
-    m_bbox  = parser->bbox();
+  for (int p = 0; p < NUM_SCENE_PARSERS; p++) {
+    if (!parserHasFiles[p])
+      continue;
+
+    std::vector<const char *> args(1, av[0]);
+    for (int i = 1; i < ac; i++) {
+      if (claimedBy[i] < 0 || claimedBy[i] == p)
+        args.push_back(av[i]);
+    }
+    args.push_back(nullptr);
+
+    auto parser = createParser(SceneParserType(p), m_renderer);
+    if (parser) parser->setBuildLOD(m_buildLOD);
+    const char **parserArgs = args.data();
+    if (parser && parser->parse(int(args.size()) - 1, parserArgs))
+      parsers.push_back(std::move(parser));
+  }
+
+  if (parsers.empty())
+    return false;
+
+  // the parsers go away, the memory their models render from must not
+  for (const auto &parser : parsers) {
+    const SceneHostData hostData = parser->hostData();
+    m_hostData.insert(m_hostData.end(), hostData.begin(), hostData.end());
+  }
+
+  if (parsers.size() == 1) {
+    m_model = parsers[0]->model();
+    m_bbox  = parsers[0]->bbox();
+    m_lod   = parsers[0]->lod();
+    return true;
   }
 
-  return parser != nullptr;
+  combine(parsers);
+  return true;
+}
+
+void MultiSceneParser::combine(
+    const std::vector<std::unique_ptr<SceneParser>> &parsers)
+{
+  // volumes can't be instanced, so the last parser's model (the volume
+  // scene, if there is one) becomes the combined model, and the others get
+  // added to it: their geometries directly where the parser can (a
+  // triangle mesh model may hold instances, which can't be instanced
+  // again), and as an instance of their whole model otherwise
+  m_model = parsers.back()->model();
+  m_bbox  = parsers.back()->bbox();
+
+  AffineSpace3f identity = one;
+
+  for (size_t i = 0; i + 1 < parsers.size(); i++) {
+    if (!parsers[i]->addGeometriesTo(m_model)) {
+      OSPGeometry inst =
+          ospNewInstance(parsers[i]->model().handle(),
+                         reinterpret_cast<osp::affine3f&>(identity));
+      m_model.addGeometry(inst);
+    }
+    m_bbox.extend(parsers[i]->bbox());
+  }
+
+  m_model.commit();
+
+  // a proxy of only the triangle meshes would hide the rest of the scene
+  m_lod = nullptr;
 }
 
 cpp::Model MultiSceneParser::model() const
@@ -82,3 +268,13 @@ box3f MultiSceneParser::bbox() const
 {
   return m_bbox;
 }
+
+std::shared_ptr<TriangleMeshLOD> MultiSceneParser::lod() const
+{
+  return m_lod;
+}
+
+SceneHostData MultiSceneParser::hostData() const
+{
+  return m_hostData;
+}
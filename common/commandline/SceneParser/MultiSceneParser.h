@@ -19,6 +19,9 @@
 #include <common/commandline/SceneParser/SceneParser.h>
 #include <ospray_cpp/Renderer.h>
 
+#include <memory>
+#include <vector>
+
 class MultiSceneParser : public SceneParser
 {
 public:
@@ -28,14 +31,19 @@ public:
 
   ospray::cpp::Model model() const override;
   ospcommon::box3f   bbox()  const override;
+  std::shared_ptr<TriangleMeshLOD> lod() const override;
+  SceneHostData hostData() const override;
 
 protected:
 
   ospray::cpp::Renderer m_renderer;
   ospray::cpp::Model    m_model;
   ospcommon::box3f      m_bbox;
+  std::shared_ptr<TriangleMeshLOD> m_lod;
+  SceneHostData         m_hostData;
 
 private:
 
-  void finalize();
+  // merge the scenes of several parsers into one model
+  void combine(const std::vector<std::unique_ptr<SceneParser>> &parsers);
 };
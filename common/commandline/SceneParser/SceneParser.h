@@ -19,10 +19,46 @@
 #include <common/commandline/CommandLineParser.h>
 #include <ospray_cpp/Model.h>
 #include <ospcommon/box.h>
+#include <ospcommon/RefCount.h>
+
+#include <memory>
+#include <vector>
+
+class TriangleMeshLOD;
+
+/*! host memory that a scene's ospray objects read from directly (data
+    created with OSP_DATA_SHARED_BUFFER, eg from a mapped file); it has
+    to stay alive for as long as the scene's model gets rendered */
+using SceneHostData = std::vector<ospcommon::Ref<ospcommon::RefCount>>;
 
 class SceneParser : public CommandLineParser
 {
 public:
   virtual ospray::cpp::Model model() const = 0;
   virtual ospcommon::box3f   bbox()  const = 0;
+
+  /*! simplified stand-in for model() to render while navigating, if the
+      scene has one */
+  virtual std::shared_ptr<TriangleMeshLOD> lod() const { return nullptr; }
+
+  /*! whether parse() builds the lod() proxy the options ask for; off by
+      default, as only a caller that renders the proxy should pay for
+      building it */
+  void setBuildLOD(bool build) { m_buildLOD = build; }
+
+  /*! host memory model() uses directly, if any; whoever renders the
+      model has to keep it */
+  virtual SceneHostData hostData() const { return SceneHostData(); }
+
+  /*! add what model() holds to 'model' directly, rather than as an
+      instance of model(); false if the parser can't. needed for models
+      that contain instances themselves, as instances can't be nested */
+  virtual bool addGeometriesTo(ospray::cpp::Model model) const
+  {
+    return false;
+  }
+
+protected:
+
+  bool m_buildLOD = false;
 };
@@ -124,17 +124,13 @@ bool ParticleSceneParser::parse(int ac, const char **&av)
         m->loadXYZ2(fn);
         particleModel.push_back(m);
         loadedScene = true;
-#if 1 // NOTE(jda) - The '.xml' file extension conflicts with RIVL files in
-      //             TriangleMeshSceneParser...disabling here for now until the
-      //             the problem requires a solution.
-      }
-#else
       } else if (fn.ext() == "xml") {
+        // NOTE: only reached for Uintah timesteps, MultiSceneParser hands
+        //       RIVL '.xml' files to TriangleMeshSceneParser
         particle::Model *m = particle::parse__Uintah_timestep_xml(fn);
         particleModel.push_back(m);
         loadedScene = true;
       }
-#endif
     }
   }
 
@@ -16,7 +16,9 @@
 
 #include "StreamLineSceneParser.h"
 
-#include "common/xml/XML.h"
+#include "common/xml/XMLStream.h"
+#include "common/xml/NumberParser.h"
+#include "common/miniSG/importer.h"
 
 using namespace ospray;
 using namespace ospcommon;
@@ -27,11 +29,40 @@ using std::endl;
 
 // Helper types ///////////////////////////////////////////////////////////////
 
+/*! an array of a scene: either one of its vectors, or a range of a
+    mapped binary osx file (see exportOSXBinary()) */
+template<typename T>
+struct OSXArray {
+  OSXArray() : data(nullptr), num(0) {}
+  OSXArray(const T *data, size_t num) : data(data), num(num) {}
+  OSXArray(const std::vector<T> &v)
+    : data(v.empty() ? nullptr : &v[0]), num(v.size()) {}
+
+  const T &operator[](size_t i) const { return data[i]; }
+
+  const T *data;
+  size_t   num;
+};
+
 struct Triangles {
   std::vector<vec3fa> vertex;
   std::vector<vec3fa> color; // vertex color, from sv's 'v' value
   std::vector<vec3i>  index;
 
+  // arrays read from a binary osx file; where set, they take the place
+  // of the vectors above
+  Ref<miniSG::MappedFile> binFile;
+  OSXArray<vec3fa> binVertex;
+  OSXArray<vec3fa> binColor;
+  OSXArray<vec3i>  binIndex;
+
+  OSXArray<vec3fa> vertexArray() const
+  { return binVertex.data ? binVertex : OSXArray<vec3fa>(vertex); }
+  OSXArray<vec3fa> colorArray() const
+  { return binColor.data ? binColor : OSXArray<vec3fa>(color); }
+  OSXArray<vec3i> indexArray() const
+  { return binIndex.data ? binIndex : OSXArray<vec3i>(index); }
+
   struct SVVertex {
     float v;
     vec3f pos; //float x,y,z;
@@ -72,8 +103,9 @@ struct Triangles {
 
   box3f getBounds() const
   {
+    const OSXArray<vec3fa> vertex = vertexArray();
     box3f bounds = empty;
-    for (int i=0;i<vertex.size();i++)
+    for (size_t i=0;i<vertex.num;i++)
       bounds.extend(vertex[i]);
     return bounds;
   }
@@ -84,8 +116,19 @@ struct StreamLines {
   std::vector<int>    index;
   float radius;
 
+  // arrays read from a binary osx file; where set, they take the place
+  // of the vectors above
+  Ref<miniSG::MappedFile> binFile;
+  OSXArray<vec3fa> binVertex;
+  OSXArray<int>    binIndex;
+
   StreamLines() : radius(0.001f) {}
 
+  OSXArray<vec3fa> vertexArray() const
+  { return binVertex.data ? binVertex : OSXArray<vec3fa>(vertex); }
+  OSXArray<int> indexArray() const
+  { return binIndex.data ? binIndex : OSXArray<int>(index); }
+
   void parsePNT(const FileName &fn)
   {
     FILE *file = fopen(fn.c_str(),"r");
@@ -195,8 +238,9 @@ struct StreamLines {
   }
   box3f getBounds() const
   {
+    const OSXArray<vec3fa> vertex = vertexArray();
     box3f bounds = empty;
-    for (int i=0;i<vertex.size();i++)
+    for (size_t i=0;i<vertex.num;i++)
       bounds.extend(vertex[i]);
     return bounds;
   }
@@ -256,179 +300,295 @@ struct StockleyWhealCannon {
   }
 };
 
-void osxParseInts(std::vector<int> &vec, const std::string &content)
+/*! streams an osx file: the (potentially huge) vertex, color and index
+    lists get parsed piece by piece while the file is being read, instead
+    of being collected into a single string first. Lists written by
+    exportOSXBinary() instead have 'ofs' and 'num' properties; they get
+    mapped from the file's .bin file, and are not copied at all */
+class OSXReader : public xml::StreamHandler
 {
-  char *s = strdup(content.c_str());
-  const char *delim = "\n\t\r ";
-  char *tok = strtok(s,delim);
-  while (tok) {
-    vec.push_back(atol(tok));
-    tok = strtok(NULL,delim);
+public:
+  OSXReader(StreamLines *streamLines, Triangles *triangles,
+            const std::string &fn)
+    : streamLines(streamLines),
+      triangles(triangles),
+      fileName(fn),
+      vec3fas(nullptr),
+      vec3is(nullptr),
+      ints(nullptr),
+      binVec3fas(nullptr),
+      binVec3is(nullptr),
+      binInts(nullptr),
+      numSkipped(0)
+  {}
+
+  /*! number of tokens that were skipped for not being numbers */
+  size_t numSkippedTokens() const { return numSkipped; }
+
+  void startElement(const xml::StringRef &name,
+                    const std::vector<xml::ArenaProp> &props) override
+  {
+    if (path.empty() && name != "OSPRay")
+      throw std::runtime_error("could not parse osx file: Not in OSPRay format!?");
+    path.push_back(name.str());
+
+    vec3fas = nullptr;
+    vec3is  = nullptr;
+    ints    = nullptr;
+    if (path.size() != 4 || path[1] != "Model")
+      return;
+
+    if (path[2] == "StreamLines") {
+      if (name == "vertex")
+        select(streamLines, streamLines->vertex, streamLines->binVertex,
+               vec3fas, binVec3fas, "vec3fa", props);
+      if (name == "index")
+        select(streamLines, streamLines->index, streamLines->binIndex,
+               ints, binInts, "int", props);
+    } else if (path[2] == "TriangleMesh") {
+      if (name == "vertex")
+        select(triangles, triangles->vertex, triangles->binVertex,
+               vec3fas, binVec3fas, "vec3fa", props);
+      if (name == "color")
+        select(triangles, triangles->color, triangles->binColor,
+               vec3fas, binVec3fas, "vec3fa", props);
+      if (name == "index")
+        select(triangles, triangles->index, triangles->binIndex,
+               vec3is, binVec3is, "vec3i", props);
+    }
   }
-  free(s);
-}
 
-void osxParseVec3is(std::vector<vec3i> &vec, const std::string &content)
-{
-  char *s = strdup(content.c_str());
-  const char *delim = "\n\t\r ";
-  char *tok = strtok(s,delim);
-  while (tok) {
-    vec3i v;
-    assert(tok);
-    v.x = atol(tok);
-    tok = strtok(NULL,delim);
-
-    assert(tok);
-    v.y = atol(tok);
-    tok = strtok(NULL,delim);
-
-    assert(tok);
-    v.z = atol(tok);
-    tok = strtok(NULL,delim);
-
-    vec.push_back(v);
+  void content(const xml::StringRef &piece) override
+  {
+    if (!vec3fas && !vec3is && !ints)
+      return;
+
+    // numbers get appended to the vectors, so these can no longer stay
+    // in the mapped file
+    if (vec3fas) unshare(*vec3fas, *binVec3fas);
+    if (vec3is)  unshare(*vec3is,  *binVec3is);
+    if (ints)    unshare(*ints,    *binInts);
+
+    const char *s   = piece.begin();
+    const char *end = piece.end();
+
+    // finish the number the previous piece ended in the middle of
+    if (!carry.empty()) {
+      const char *numberEnd = xml::findNumberDelimiter(s, end);
+      carry.append(s, numberEnd);
+      if (numberEnd == end)
+        return;
+      parseNumbers(carry.data(), carry.data() + carry.size());
+      carry.clear();
+      s = numberEnd;
+    }
+
+    // a number that touches the end of this piece may go on in the next
+    const char *last = end;
+    while (last > s && !xml::isNumberDelimiter(last[-1])) --last;
+    carry.assign(last, end);
+
+    parseNumbers(s, last);
   }
-  free(s);
-}
 
-void osxParseVec3fas(std::vector<vec3fa> &vec, const std::string &content)
-{
-  char *s = strdup(content.c_str());
-  const char *delim = "\n\t\r ";
-  char *tok = strtok(s,delim);
-  while (tok) {
-    vec3fa v;
-    assert(tok);
-    v.x = atof(tok);
-    tok = strtok(NULL,delim);
-
-    assert(tok);
-    v.y = atof(tok);
-    tok = strtok(NULL,delim);
-
-    assert(tok);
-    v.z = atof(tok);
-    tok = strtok(NULL,delim);
-
-    vec.push_back(v);
+  void endElement(const xml::StringRef &) override
+  {
+    if (!carry.empty()) {
+      parseNumbers(carry.data(), carry.data() + carry.size());
+      carry.clear();
+    }
+    vec3fas = nullptr;
+    vec3is  = nullptr;
+    ints    = nullptr;
+    pendingFloats.clear();
+    pendingInts.clear();
+    path.pop_back();
+  }
+
+private:
+
+  /*! make 'vec' (and 'bin') the list the current node goes to; if the
+      node refers to the binary file, its data gets appended right away */
+  template<typename Scene, typename T>
+  void select(Scene *scene, std::vector<T> &vec, OSXArray<T> &bin,
+              std::vector<T> *&target, OSXArray<T> *&binTarget,
+              const char *format,
+              const std::vector<xml::ArenaProp> &props)
+  {
+    const xml::StringRef *ofs = nullptr, *num = nullptr;
+    for (size_t i = 0; i < props.size(); i++) {
+      if (props[i].name == "ofs") ofs = &props[i].value;
+      else if (props[i].name == "num") num = &props[i].value;
+      else if (props[i].name == "format" && props[i].value != format) {
+        throw std::runtime_error("osx file " + fileName + ": expected "
+                                 + format + " data in '" + path.back()
+                                 + "' node, not " + props[i].value.str());
+      }
+    }
+
+    if (!ofs) {
+      target    = &vec;
+      binTarget = &bin;
+      return;
+    }
+    if (!num) {
+      throw std::runtime_error("osx file " + fileName + ": '" + path.back()
+                               + "' node has an 'ofs' but no 'num'");
+    }
+
+    const size_t n = strtoull(num->str().c_str(), nullptr, 10);
+    const T *data = mapped<T>(strtoull(ofs->str().c_str(), nullptr, 10), n);
+    if (vec.empty() && !bin.data) {
+      bin = OSXArray<T>(data, n);
+      scene->binFile = binFile;
+    } else {
+      unshare(vec, bin);
+      vec.insert(vec.end(), data, data + n);
+    }
+  }
+
+  /*! pointer to 'num' items at offset 'ofs' into the binary file,
+      which gets mapped on first use */
+  template<typename T>
+  const T *mapped(size_t ofs, size_t num)
+  {
+    if (!binFile)
+      binFile = new miniSG::MappedFile(fileName + ".bin");
+    if (ofs % alignof(T) || ofs > binFile->size ||
+        num > (binFile->size - ofs) / sizeof(T)) {
+      throw std::runtime_error("osx file " + fileName + ": '" + path.back()
+                               + "' node refers to data outside of "
+                               + fileName + ".bin");
+    }
+    return (const T *)(binFile->data + ofs);
+  }
+
+  /*! move a list from the mapped file into its vector */
+  template<typename T>
+  static void unshare(std::vector<T> &vec, OSXArray<T> &bin)
+  {
+    if (!bin.data) return;
+    vec.insert(vec.begin(), bin.data, bin.data + bin.num);
+    bin = OSXArray<T>();
   }
-  free(s);
-}
+
+  /*! append the numbers in [begin,end) to the list being read; vec3
+      lists get their components collected first, and take as many
+      complete vec3s from them as there are */
+  void parseNumbers(const char *begin, const char *end)
+  {
+    if (ints) {
+      numSkipped += xml::parseNumberList(begin, end, *ints);
+    } else if (vec3is) {
+      numSkipped += xml::parseNumberList(begin, end, pendingInts);
+      takeVec3s(pendingInts, *vec3is);
+    } else {
+      numSkipped += xml::parseNumberList(begin, end, pendingFloats);
+      takeVec3s(pendingFloats, *vec3fas);
+    }
+  }
+
+  template<typename T, typename V>
+  static void takeVec3s(std::vector<T> &components, std::vector<V> &vec)
+  {
+    const size_t num = components.size() / 3;
+    const size_t first = vec.size();
+    vec.resize(first + num);
+    for (size_t i = 0; i < num; i++) {
+      vec[first+i] = V(components[3*i+0],
+                       components[3*i+1],
+                       components[3*i+2]);
+    }
+    components.erase(components.begin(), components.begin() + 3*num);
+  }
+
+  StreamLines *streamLines;
+  Triangles   *triangles;
+
+  // the osx file, and its .bin file once some node refers to it
+  std::string             fileName;
+  Ref<miniSG::MappedFile> binFile;
+
+  // names of all open nodes, outermost first
+  std::vector<std::string> path;
+
+  // the list the current node's content goes to, if any
+  std::vector<vec3fa> *vec3fas;
+  std::vector<vec3i>  *vec3is;
+  std::vector<int>    *ints;
+  OSXArray<vec3fa>    *binVec3fas;
+  OSXArray<vec3i>     *binVec3is;
+  OSXArray<int>       *binInts;
+
+  // components read, but not yet taken into a vec3; and a number that
+  // got cut off at the end of the last piece of content
+  std::vector<float> pendingFloats;
+  std::vector<int>   pendingInts;
+  std::string        carry;
+
+  size_t numSkipped;
+};
 
 /*! parse ospray xml file */
 void parseOSX(StreamLines *streamLines,
               Triangles *triangles,
               const std::string &fn)
 {
-  xml::XMLDoc *doc = xml::readXML(fn);
-  assert(doc);
-  if (doc->child.size() != 1 || doc->child[0]->name != "OSPRay")
-    throw std::runtime_error("could not parse osx file: Not in OSPRay format!?");
-  xml::Node *root_element = doc->child[0];
-  for (int childID=0;childID<root_element->child.size();childID++) {
-    xml::Node *node = root_element->child[childID];
-    if (node->name == "Info") {
-      // ignore
-      continue;
-    }
-
-    if (node->name == "Model") {
-      xml::Node *model_node = node;
-      for (int childID=0;childID<model_node->child.size();childID++) {
-        xml::Node *node = model_node->child[childID];
-
-        if (node->name == "StreamLines") {
-
-          xml::Node *sl_node = node;
-          for (int childID=0;childID<sl_node->child.size();childID++) {
-            xml::Node *node = sl_node->child[childID];
-            if (node->name == "vertex") {
-              osxParseVec3fas(streamLines->vertex,node->content);
-              continue;
-            };
-            if (node->name == "index") {
-              osxParseInts(streamLines->index,node->content);
-              continue;
-            };
-          }
-          continue;
-        }
-
-        if (node->name == "TriangleMesh") {
-          xml::Node *tris_node = node;
-          for (int childID=0;childID<tris_node->child.size();childID++) {
-            xml::Node *node = tris_node->child[childID];
-            if (node->name == "vertex") {
-              osxParseVec3fas(triangles->vertex,node->content);
-              continue;
-            };
-            if (node->name == "color") {
-              osxParseVec3fas(triangles->color,node->content);
-              continue;
-            };
-            if (node->name == "index") {
-              osxParseVec3is(triangles->index,node->content);
-              continue;
-            };
-          }
-          continue;
-        }
-      }
-    }
+  // pieces of a few MB are large enough to get parsed in parallel
+  OSXReader reader(streamLines, triangles, fn);
+  xml::parseXMLStream(fn, reader, 16<<20);
+  if (reader.numSkippedTokens()) {
+    cout << "WARNING: skipped " << reader.numSkippedTokens()
+         << " values that are not numbers in " << fn << endl;
   }
 }
 
 void exportOSX(const char *fn,StreamLines *streamLines, Triangles *triangles)
 {
   FILE *file = fopen(fn,"w");
+  if (!file)
+    throw std::runtime_error("could not open "+std::string(fn)+" for writing");
   fprintf(file,"<?xml version=\"1.0\"?>\n\n");
   fprintf(file,"<OSPRay>\n");
   {
     fprintf(file,"<Model>\n");
-    {
+    if (streamLines) {
+      const OSXArray<vec3fa> vertex = streamLines->vertexArray();
+      const OSXArray<int>    index  = streamLines->indexArray();
       fprintf(file,"<StreamLines>\n");
       {
         fprintf(file,"<vertex>\n");
-        for (int i=0;i<streamLines->vertex.size();i++)
-          fprintf(file,"%f %f %f\n",
-                  streamLines->vertex[i].x,
-                  streamLines->vertex[i].y,
-                  streamLines->vertex[i].z);
+        for (size_t i=0;i<vertex.num;i++)
+          fprintf(file,"%f %f %f\n",vertex[i].x,vertex[i].y,vertex[i].z);
         fprintf(file,"</vertex>\n");
 
         fprintf(file,"<index>\n");
-        for (int i=0;i<streamLines->index.size();i++)
-          fprintf(file,"%i ",streamLines->index[i]);
+        for (size_t i=0;i<index.num;i++)
+          fprintf(file,"%i ",index[i]);
         fprintf(file,"\n</index>\n");
       }
       fprintf(file,"</StreamLines>\n");
+    }
 
-
+    if (triangles) {
+      const OSXArray<vec3fa> vertex = triangles->vertexArray();
+      const OSXArray<vec3fa> color  = triangles->colorArray();
+      const OSXArray<vec3i>  index  = triangles->indexArray();
       fprintf(file,"<TriangleMesh>\n");
       {
         fprintf(file,"<vertex>\n");
-        for (int i=0;i<triangles->vertex.size();i++)
-          fprintf(file,"%f %f %f\n",
-                  triangles->vertex[i].x,
-                  triangles->vertex[i].y,
-                  triangles->vertex[i].z);
+        for (size_t i=0;i<vertex.num;i++)
+          fprintf(file,"%f %f %f\n",vertex[i].x,vertex[i].y,vertex[i].z);
         fprintf(file,"</vertex>\n");
 
         fprintf(file,"<color>\n");
-        for (int i=0;i<triangles->color.size();i++)
-          fprintf(file,"%f %f %f\n",
-                  triangles->color[i].x,
-                  triangles->color[i].y,
-                  triangles->color[i].z);
+        for (size_t i=0;i<color.num;i++)
+          fprintf(file,"%f %f %f\n",color[i].x,color[i].y,color[i].z);
         fprintf(file,"</color>\n");
 
         fprintf(file,"<index>\n");
-        for (int i=0;i<triangles->index.size();i++)
-          fprintf(file,"%i %i %i\n",
-                  triangles->index[i].x,
-                  triangles->index[i].y,
-                  triangles->index[i].z);
+        for (size_t i=0;i<index.num;i++)
+          fprintf(file,"%i %i %i\n",index[i].x,index[i].y,index[i].z);
         fprintf(file,"</index>\n");
 
       }
@@ -440,6 +600,76 @@ void exportOSX(const char *fn,StreamLines *streamLines, Triangles *triangles)
   fclose(file);
 }
 
+/*! write one list of a binary osx file: the data goes, aligned, into
+    the .bin file, and the node only records where */
+template<typename T>
+static void writeOSXArray(xml::Writer &writer, const char *name,
+                          const char *format, const OSXArray<T> &array)
+{
+  writer.alignData(16);
+  const size_t ofs = writer.writeData(array.data, array.num*sizeof(T));
+  writer.openNode(name);
+  writer.writeProperty("ofs", xml::toString(int64_t(ofs)));
+  writer.writeProperty("num", xml::toString(int64_t(array.num)));
+  writer.writeProperty("format", format);
+  writer.closeNode();
+}
+
+/*! like exportOSX(), but with the lists in a separate '<fn>.bin' file,
+    in the layout they have in memory; parseOSX() maps that file, and
+    hands the lists to ospray as they are */
+void exportOSXBinary(const std::string &fn,
+                     StreamLines *streamLines, Triangles *triangles)
+{
+  FILE *xmlFile = fopen(fn.c_str(),"w");
+  FILE *binFile = fopen((fn+".bin").c_str(),"wb");
+  if (!xmlFile || !binFile) {
+    if (xmlFile) fclose(xmlFile);
+    if (binFile) fclose(binFile);
+    throw std::runtime_error("could not open "+fn+" (and "+fn
+                             +".bin) for writing");
+  }
+
+  xml::Writer writer(xmlFile, binFile);
+  writer.writeHeader("1.0");
+  writer.openNode("OSPRay");
+  writer.openNode("Model");
+  if (streamLines) {
+    writer.openNode("StreamLines");
+    writeOSXArray(writer, "vertex", "vec3fa", streamLines->vertexArray());
+    writeOSXArray(writer, "index",  "int",    streamLines->indexArray());
+    writer.closeNode();
+  }
+  if (triangles) {
+    writer.openNode("TriangleMesh");
+    writeOSXArray(writer, "vertex", "vec3fa", triangles->vertexArray());
+    writeOSXArray(writer, "color",  "vec3fa", triangles->colorArray());
+    writeOSXArray(writer, "index",  "vec3i",  triangles->indexArray());
+    writer.closeNode();
+  }
+  writer.closeNode();
+  writer.closeNode();
+  writer.writeFooter();
+
+  const bool failed = ferror(xmlFile) || ferror(binFile);
+  fclose(xmlFile);
+  fclose(binFile);
+  if (failed)
+    throw std::runtime_error("could not write "+fn);
+}
+
+/*! ospray data for one of the scene's lists; lists that live in a
+    mapped file get shared instead of copied, so the mapping has to
+    stay around for as long as ospray may use them */
+template<typename T>
+static OSPData newOSXData(const OSXArray<T> &array, OSPDataType type,
+                          bool mapped)
+{
+  if (!mapped)
+    return ospNewData(array.num, type, array.data);
+  return ospNewData(array.num, type, array.data, OSP_DATA_SHARED_BUFFER);
+}
+
 // Class definitions //////////////////////////////////////////////////////////
 
 StreamLineSceneParser::StreamLineSceneParser(cpp::Renderer renderer) :
@@ -455,6 +685,8 @@ bool StreamLineSceneParser::parse(int ac, const char **&av)
   Triangles   *triangles = nullptr;//new Triangles;
   StockleyWhealCannon *swc = nullptr;//new StockleyWhealCannon;
 
+  std::string exportFile, binaryExportFile;
+
   for (int i = 1; i < ac; i++) {
     std::string arg = av[i];
     if (arg[0] != '-') {
@@ -492,15 +724,19 @@ bool StreamLineSceneParser::parse(int ac, const char **&av)
       }
     } else if (arg == "--streamline-radius") {
       streamLines->radius = atof(av[++i]);
-#if 1
-    }
-#else
     } else if (arg == "--streamline-export") {
-      exportOSX(av[++i], streamLines, triangles);
+      exportFile = av[++i];
+    } else if (arg == "--streamline-export-binary") {
+      binaryExportFile = av[++i];
     }
-#endif
   }
 
+  // export once all input files got read
+  if (loadedScene && !exportFile.empty())
+    exportOSX(exportFile.c_str(), streamLines, triangles);
+  if (loadedScene && !binaryExportFile.empty())
+    exportOSXBinary(binaryExportFile, streamLines, triangles);
+
   if (loadedScene) {
     m_model = ospNewModel();
 
@@ -512,13 +748,15 @@ bool StreamLineSceneParser::parse(int ac, const char **&av)
 
     box3f bounds(empty);
 
-    if (streamLines && !streamLines->index.empty()) {
+    if (streamLines && streamLines->indexArray().num) {
       OSPGeometry geom = ospNewGeometry("streamlines");
       Assert(geom);
-      OSPData vertex = ospNewData(streamLines->vertex.size(),
-                                  OSP_FLOAT3A, &streamLines->vertex[0]);
-      OSPData index  = ospNewData(streamLines->index.size(),
-                                  OSP_UINT, &streamLines->index[0]);
+      if (streamLines->binVertex.data || streamLines->binIndex.data)
+        m_binFile = streamLines->binFile;
+      OSPData vertex = newOSXData(streamLines->vertexArray(), OSP_FLOAT3A,
+                                  streamLines->binVertex.data);
+      OSPData index  = newOSXData(streamLines->indexArray(), OSP_UINT,
+                                  streamLines->binIndex.data);
       ospSetObject(geom,"vertex",vertex);
       ospSetObject(geom,"index",index);
       ospSet1f(geom,"radius",streamLines->radius);
@@ -529,15 +767,18 @@ bool StreamLineSceneParser::parse(int ac, const char **&av)
       bounds.extend(streamLines->getBounds());
     }
 
-    if (triangles && !triangles->index.empty()) {
+    if (triangles && triangles->indexArray().num) {
       OSPGeometry geom = ospNewGeometry("triangles");
       Assert(geom);
-      OSPData vertex = ospNewData(triangles->vertex.size(),
-                                  OSP_FLOAT3A, &triangles->vertex[0]);
-      OSPData index  = ospNewData(triangles->index.size(),
-                                  OSP_INT3, &triangles->index[0]);
-      OSPData color  = ospNewData(triangles->color.size(),
-                                  OSP_FLOAT3A, &triangles->color[0]);
+      if (triangles->binVertex.data || triangles->binIndex.data ||
+          triangles->binColor.data)
+        m_binFile = triangles->binFile;
+      OSPData vertex = newOSXData(triangles->vertexArray(), OSP_FLOAT3A,
+                                  triangles->binVertex.data);
+      OSPData index  = newOSXData(triangles->indexArray(), OSP_INT3,
+                                  triangles->binIndex.data);
+      OSPData color  = newOSXData(triangles->colorArray(), OSP_FLOAT3A,
+                                  triangles->binColor.data);
       ospSetObject(geom, "vertex", vertex);
       ospSetObject(geom, "index", index);
       ospSetObject(geom, "vertex.color", color);
@@ -615,3 +856,11 @@ box3f StreamLineSceneParser::bbox() const
 {
   return m_bbox;
 }
+
+SceneHostData StreamLineSceneParser::hostData() const
+{
+  SceneHostData hostData;
+  if (m_binFile)
+    hostData.push_back(m_binFile);
+  return hostData;
+}
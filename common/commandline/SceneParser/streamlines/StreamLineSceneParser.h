@@ -19,6 +19,7 @@
 #include <common/commandline/SceneParser/SceneParser.h>
 #include <ospray_cpp/Renderer.h>
 #include <common/miniSG/miniSG.h>
+#include <common/miniSG/importer.h>
 
 #include <string>
 
@@ -32,10 +33,13 @@ public:
 
   ospray::cpp::Model model() const override;
   ospcommon::box3f   bbox()  const override;
+  SceneHostData hostData() const override;
 
 private:
 
   ospray::cpp::Model    m_model;
+  //! the mapped .osx binary data m_model shares lists with, if any
+  ospcommon::Ref<ospray::miniSG::MappedFile> m_binFile;
   ospray::cpp::Renderer m_renderer;
   ospcommon::box3f      m_bbox;
 
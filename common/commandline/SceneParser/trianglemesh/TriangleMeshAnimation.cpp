@@ -0,0 +1,267 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "TriangleMeshAnimation.h"
+#include "TriangleMeshSceneParser.h"
+
+#include <algorithm>
+#include <exception>
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+TriangleMeshAnimation::TriangleMeshAnimation(
+    ospray::cpp::Renderer renderer,
+    const std::vector<std::string> &timeSteps,
+    int ac, const char **av,
+    int numPrefetched) :
+  m_renderer(renderer),
+  m_timeSteps(timeSteps),
+  m_options(av, av + ac),
+  m_numPrefetched(std::max(1, numPrefetched)),
+  m_playing(true),
+  m_frameRate(10.f),
+  m_lastSwitch(std::chrono::steady_clock::now()),
+  m_current(0),
+  m_quit(false)
+{
+  // the first time step is what the scene parser loaded
+  if (m_timeSteps.size() > 1)
+    m_loader = std::thread([this]() { loadTimeSteps(); });
+}
+
+TriangleMeshAnimation::~TriangleMeshAnimation()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_quit = true;
+  }
+  m_currentChanged.notify_all();
+  if (m_loader.joinable())
+    m_loader.join();
+
+  for (auto &step : m_resident) {
+    if (step.second.uploaded)
+      ospRelease(step.second.parser->model().handle());
+  }
+}
+
+size_t TriangleMeshAnimation::numTimeSteps() const
+{
+  return m_timeSteps.size();
+}
+
+size_t TriangleMeshAnimation::currentTimeStep() const
+{
+  std::lock_guard<std::mutex> lock(const_cast<std::mutex &>(m_mutex));
+  return m_current;
+}
+
+void TriangleMeshAnimation::setPlaying(bool playing)
+{
+  m_playing = playing;
+}
+
+bool TriangleMeshAnimation::playing() const
+{
+  return m_playing;
+}
+
+void TriangleMeshAnimation::setFrameRate(float framesPerSecond)
+{
+  m_frameRate = std::max(framesPerSecond, 1e-3f);
+}
+
+float TriangleMeshAnimation::frameRate() const
+{
+  return m_frameRate;
+}
+
+bool TriangleMeshAnimation::update(ospray::cpp::Model &model)
+{
+  if (m_timeSteps.size() < 2)
+    return false;
+
+  dropTimeSteps();
+  uploadTimeStep();
+
+  if (!m_playing)
+    return false;
+
+  const auto now = std::chrono::steady_clock::now();
+  const std::chrono::duration<float> sinceLastSwitch = now - m_lastSwitch;
+  if (sinceLastSwitch.count() < 1.f/m_frameRate)
+    return false;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const size_t next = nextTimeStep();
+  auto it = m_resident.find(next);
+  if (next == m_current || it == m_resident.end() || !it->second.uploaded)
+    return false;
+
+  model = it->second.parser->model();
+  m_current = next;
+  m_lastSwitch = now;
+  m_currentChanged.notify_all();
+  return true;
+}
+
+/*! true for the current time step, and the next 'm_numPrefetched' ones
+    that didn't fail to load */
+bool TriangleMeshAnimation::inWindow(size_t timeStep) const
+{
+  if (timeStep == m_current)
+    return true;
+
+  const size_t N = m_timeSteps.size();
+  int ahead = 0;
+  for (size_t i = 1; i < N && ahead < m_numPrefetched; i++) {
+    const size_t step = (m_current + i) % N;
+    if (m_failed.find(step) != m_failed.end())
+      continue;
+    if (step == timeStep)
+      return true;
+    ahead++;
+  }
+  return false;
+}
+
+/*! the time step after the current one, skipping those that failed to
+    load; the current one if all others failed */
+size_t TriangleMeshAnimation::nextTimeStep() const
+{
+  const size_t N = m_timeSteps.size();
+  for (size_t i = 1; i < N; i++) {
+    const size_t step = (m_current + i) % N;
+    if (m_failed.find(step) == m_failed.end())
+      return step;
+  }
+  return m_current;
+}
+
+void TriangleMeshAnimation::loadTimeSteps()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_quit) {
+    // find the closest upcoming time step that isn't resident yet
+    const size_t N = m_timeSteps.size();
+    size_t wanted = N;
+    for (size_t i = 1; i < N && wanted == N; i++) {
+      const size_t step = (m_current + i) % N;
+      if (m_failed.find(step) != m_failed.end())
+        continue;
+      if (!inWindow(step))
+        break;
+      if (m_resident.find(step) == m_resident.end())
+        wanted = step;
+    }
+
+    if (wanted == N) {
+      m_currentChanged.wait(lock);
+      continue;
+    }
+
+    lock.unlock();
+    auto parser = loadTimeStep(wanted);
+    lock.lock();
+
+    // a step that failed keeps the animation on the previous frame, and
+    // gets skipped from then on
+    if (parser)
+      m_resident[wanted] = TimeStep{parser, false};
+    else
+      m_failed.insert(wanted);
+  }
+}
+
+/*! read a time step into host memory; runs on the loader thread, so it
+    must not make any ospray calls */
+std::shared_ptr<TriangleMeshSceneParser>
+TriangleMeshAnimation::loadTimeStep(size_t timeStep)
+{
+  auto parser = std::make_shared<TriangleMeshSceneParser>(m_renderer);
+
+  std::vector<const char *> args;
+  for (const auto &arg : m_options)
+    args.push_back(arg.c_str());
+  parser->parseOptions(int(args.size()), args.data());
+
+  bool loaded = false;
+  try {
+    loaded = parser->import({m_timeSteps[timeStep]}) &&
+             !parser->bbox().empty();
+  } catch (const std::exception &e) {
+    cout << "#TriangleMeshAnimation: " << e.what() << endl;
+  }
+
+  if (!loaded) {
+    cout << "#TriangleMeshAnimation: could not load time step "
+         << timeStep << " ('" << m_timeSteps[timeStep] << "')" << endl;
+    return nullptr;
+  }
+  return parser;
+}
+
+/*! drop time steps that fell out of the window. this runs before
+    update() switches, so the step it switched away from last time is no
+    longer rendered */
+void TriangleMeshAnimation::dropTimeSteps()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto it = m_resident.begin(); it != m_resident.end();) {
+    if (inWindow(it->first)) {
+      ++it;
+    } else {
+      if (it->second.uploaded)
+        ospRelease(it->second.parser->model().handle());
+      it = m_resident.erase(it);
+    }
+  }
+}
+
+/*! create the ospray model of the closest time step the loader thread
+    has finished; at most one per frame, so uploads don't add up to a
+    long stall */
+void TriangleMeshAnimation::uploadTimeStep()
+{
+  std::shared_ptr<TriangleMeshSceneParser> parser;
+  size_t timeStep = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const size_t N = m_timeSteps.size();
+    for (size_t i = 1; i < N && !parser; i++) {
+      const size_t step = (m_current + i) % N;
+      auto it = m_resident.find(step);
+      if (it != m_resident.end() && !it->second.uploaded) {
+        parser   = it->second.parser;
+        timeStep = step;
+      }
+    }
+  }
+
+  if (!parser)
+    return;
+
+  // only this thread removes time steps, so this one is still resident
+  // afterwards
+  parser->upload(m_materials);
+  if (!m_materials)
+    m_materials = parser->materials();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_resident[timeStep].uploaded = true;
+}
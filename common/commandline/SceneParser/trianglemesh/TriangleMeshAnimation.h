@@ -0,0 +1,110 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include <ospray_cpp/Model.h>
+#include <ospray_cpp/Renderer.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TriangleMeshMaterials;
+class TriangleMeshSceneParser;
+
+/*! plays back a triangle mesh animation (one file per time step, eg the
+    STL files listed in an .astl file). only the current time step and
+    the next few are resident; those get loaded into host memory on a
+    background thread while the current one renders, and uploaded on the
+    rendering thread (ospray isn't thread safe) */
+class TriangleMeshAnimation
+{
+public:
+  /*! the triangle mesh options on the command line 'ac'/'av' (eg
+      --upload-mode, --roi, --generate-normals) apply to all time
+      steps; its scene files are ignored */
+  TriangleMeshAnimation(ospray::cpp::Renderer renderer,
+                        const std::vector<std::string> &timeSteps,
+                        int ac, const char **av,
+                        int numPrefetched = 2);
+  ~TriangleMeshAnimation();
+
+  size_t numTimeSteps() const;
+  size_t currentTimeStep() const;
+
+  void setPlaying(bool playing);
+  bool playing() const;
+
+  void  setFrameRate(float framesPerSecond);
+  float frameRate() const;
+
+  /*! to be called once per rendered frame, on the thread that renders.
+      uploads a time step the background thread has loaded, if any; then,
+      if playing, it's time for the next time step, and that step is
+      resident, switches to it and returns its model. otherwise it
+      returns false and keeps the current one, so a slow (or failed)
+      load never stalls rendering */
+  bool update(ospray::cpp::Model &model);
+
+private:
+
+  struct TimeStep
+  {
+    std::shared_ptr<TriangleMeshSceneParser> parser;
+    bool uploaded;
+  };
+
+  void loadTimeSteps();
+  bool inWindow(size_t timeStep) const;
+  size_t nextTimeStep() const;
+  std::shared_ptr<TriangleMeshSceneParser> loadTimeStep(size_t timeStep);
+  void dropTimeSteps();
+  void uploadTimeStep();
+
+  // Data //
+
+  ospray::cpp::Renderer    m_renderer;
+  std::vector<std::string> m_timeSteps;
+  std::vector<std::string> m_options;
+  int m_numPrefetched;
+
+  // shared by all time steps, so they don't each create the same
+  // materials again; only used on the rendering thread
+  std::shared_ptr<TriangleMeshMaterials> m_materials;
+
+  std::atomic<bool>  m_playing;
+  std::atomic<float> m_frameRate;
+  std::chrono::steady_clock::time_point m_lastSwitch;
+
+  // guards everything below. the loader thread only adds time steps;
+  // uploading and dropping them happens on the rendering thread
+  std::mutex m_mutex;
+  std::condition_variable m_currentChanged;
+  size_t m_current;
+  std::map<size_t, TimeStep> m_resident;
+  std::set<size_t> m_failed;
+  bool m_quit;
+
+  std::thread m_loader;
+};
@@ -0,0 +1,63 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "TriangleMeshLOD.h"
+#include "TriangleMeshSceneParser.h"
+
+TriangleMeshLOD::TriangleMeshLOD(ospray::cpp::Renderer renderer,
+                                 ospcommon::Ref<ospray::miniSG::Model> msgModel,
+                                 float ratio,
+                                 std::shared_ptr<TriangleMeshMaterials> materials) :
+  m_renderer(renderer),
+  m_model(nullptr),
+  m_materials(materials),
+  m_simplifiedReady(false)
+{
+  // only host work happens here; ospray isn't thread safe, so the upload
+  // waits for update()
+  m_builder = std::thread([=]() {
+    m_simplified = ratio < 1.f ? ospray::miniSG::simplify(*msgModel, ratio) :
+                                 msgModel;
+    m_simplifiedReady = true;
+  });
+}
+
+TriangleMeshLOD::~TriangleMeshLOD()
+{
+  if (m_builder.joinable())
+    m_builder.join();
+}
+
+bool TriangleMeshLOD::update()
+{
+  if (m_parser)
+    return true;
+  if (!m_simplifiedReady)
+    return false;
+
+  m_builder.join();
+
+  m_parser.reset(new TriangleMeshSceneParser(m_renderer));
+  m_parser->setScene(m_simplified, m_materials);
+  m_model = m_parser->model();
+  m_simplified = nullptr;
+  return true;
+}
+
+ospray::cpp::Model TriangleMeshLOD::model() const
+{
+  return m_model;
+}
@@ -0,0 +1,66 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include <ospray_cpp/Model.h>
+#include <ospray_cpp/Renderer.h>
+#include <common/miniSG/miniSG.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+class TriangleMeshMaterials;
+class TriangleMeshSceneParser;
+
+/*! simplified stand-in for a triangle mesh scene, rendered while the
+    camera moves. it gets simplified (\see miniSG::simplify()) on a
+    background thread and uploaded by update() on the rendering thread,
+    so it becomes available some time after the full scene */
+class TriangleMeshLOD
+{
+public:
+  /*! build a proxy with about 'ratio' times the vertices of 'msgModel';
+      a ratio of 1 or more uploads 'msgModel' as it is. the proxy's
+      meshes reuse the full scene's ospray materials from 'materials' */
+  TriangleMeshLOD(ospray::cpp::Renderer renderer,
+                  ospcommon::Ref<ospray::miniSG::Model> msgModel,
+                  float ratio,
+                  std::shared_ptr<TriangleMeshMaterials> materials = nullptr);
+  ~TriangleMeshLOD();
+
+  /*! uploads the proxy once its simplification is done; call this from
+      the rendering thread. true once model() can be used */
+  bool update();
+  ospray::cpp::Model model() const;
+
+private:
+
+  // Data //
+
+  ospray::cpp::Renderer m_renderer;
+  ospray::cpp::Model    m_model;
+  std::shared_ptr<TriangleMeshMaterials> m_materials;
+
+  ospcommon::Ref<ospray::miniSG::Model> m_simplified;
+  std::atomic<bool> m_simplifiedReady;
+
+  //! owns the proxy's host arrays while ospray renders from them
+  std::unique_ptr<TriangleMeshSceneParser> m_parser;
+
+  std::thread m_builder;
+};
@@ -0,0 +1,279 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "TriangleMeshMaterials.h"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+using namespace ospray;
+using namespace ospcommon;
+
+using std::cerr;
+using std::endl;
+
+// Static local helper functions //////////////////////////////////////////////
+
+using Param = miniSG::Material::Param;
+
+/*! number of values stored in a parameter of the given type */
+static int numValues(Param::DataType type)
+{
+  switch (type) {
+  case Param::INT:   case Param::UINT:   case Param::FLOAT:   return 1;
+  case Param::INT_2: case Param::UINT_2: case Param::FLOAT_2: return 2;
+  case Param::INT_3: case Param::UINT_3: case Param::FLOAT_3: return 3;
+  case Param::INT_4: case Param::UINT_4: case Param::FLOAT_4: return 4;
+  default: return 0;
+  }
+}
+
+/*! 64-bit FNV-1a hash, continued from 'h' */
+static inline uint64_t hashBytes(const void *data, size_t size, uint64_t h)
+{
+  const unsigned char *bytes = (const unsigned char *)data;
+  for (size_t i = 0; i < size; i++) {
+    h ^= bytes[i];
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+static bool sameValue(const Param &a, const Param &b)
+{
+  if (a.type != b.type)
+    return false;
+  const int n = numValues(a.type);
+  return n > 0 ? memcmp(a.i, b.i, n * sizeof(a.i[0])) == 0 : a.ptr == b.ptr;
+}
+
+/*! hash of a material's type and parameter values, no matter in which
+    order the parameters got set. names and strings are interned and
+    textures are loaded once per file, so their pointers identify them */
+static uint64_t contentHash(const miniSG::Material &mat)
+{
+  uint64_t h = 0;
+  for (const Param &p : mat.params) {
+    uint64_t hp = 0xcbf29ce484222325ull;
+    hp = hashBytes(&p.name, sizeof(p.name), hp);
+    hp = hashBytes(&p.type, sizeof(p.type), hp);
+    const int n = numValues(p.type);
+    if (n > 0)
+      hp = hashBytes(p.i, n * sizeof(p.i[0]), hp);
+    else
+      hp = hashBytes(&p.ptr, sizeof(p.ptr), hp);
+    h += hp;
+  }
+  return h;
+}
+
+/*! a material's parameter names are unique, so two materials have the
+    same content if every parameter of one has the same value in the
+    other, and they have as many parameters */
+static bool sameContent(const miniSG::Material &a, const miniSG::Material &b)
+{
+  if (a.params.size() != b.params.size())
+    return false;
+
+  for (const Param &pa : a.params) {
+    const Param *pb = b.findParam(pa.name);
+    if (!pb || !sameValue(pa, *pb))
+      return false;
+  }
+
+  return true;
+}
+
+// TriangleMeshMaterials definitions //////////////////////////////////////////
+
+TriangleMeshMaterials::TriangleMeshMaterials(cpp::Renderer renderer,
+                                             bool createDefaultMaterial) :
+  m_renderer(renderer),
+  m_createDefaultMaterial(createDefaultMaterial),
+  m_defaultMaterial(nullptr),
+  m_numMissingTextures(0),
+  m_numCreated(0),
+  m_numDeduplicated(0)
+{
+}
+
+cpp::Material TriangleMeshMaterials::material(miniSG::Material *mat)
+{
+  if (mat == nullptr) return defaultMaterial();
+
+  auto known = m_byPointer.find(mat);
+  if (known != m_byPointer.end())
+    return known->second.second;
+
+  std::vector<CachedMaterial> &sameHash = m_byContent[contentHash(*mat)];
+  for (const auto &cached : sameHash) {
+    if (sameContent(*cached.first, *mat)) {
+      m_numDeduplicated++;
+      m_byPointer[mat] = CachedMaterial(mat, cached.second);
+      return cached.second;
+    }
+  }
+
+  cpp::Material ospMat = createMaterial(mat);
+  sameHash.push_back(CachedMaterial(mat, ospMat));
+  m_byPointer[mat] = CachedMaterial(mat, ospMat);
+  return ospMat;
+}
+
+OSPTexture2D TriangleMeshMaterials::texture(miniSG::Texture2D *tex)
+{
+  return createTexture(tex);
+}
+
+size_t TriangleMeshMaterials::numCreated() const
+{
+  return m_numCreated;
+}
+
+size_t TriangleMeshMaterials::numDeduplicated() const
+{
+  return m_numDeduplicated;
+}
+
+cpp::Material TriangleMeshMaterials::defaultMaterial()
+{
+  if (!m_createDefaultMaterial) return nullptr;
+
+  if (m_defaultMaterial.handle()) return m_defaultMaterial;
+
+  m_defaultMaterial = m_renderer.newMaterial("OBJMaterial");
+
+  m_defaultMaterial.set("Kd", .8f, 0.f, 0.f);
+  m_defaultMaterial.commit();
+  return m_defaultMaterial;
+}
+
+cpp::Material TriangleMeshMaterials::createMaterial(miniSG::Material *mat)
+{
+  const char *type = mat->getParam("type", "OBJMaterial");
+  assert(type);
+
+  cpp::Material ospMat;
+  try {
+    ospMat = m_renderer.newMaterial(type);
+  } catch (const std::runtime_error &/*e*/) {
+    warnMaterial(type);
+    return defaultMaterial();
+  }
+
+  m_numCreated++;
+
+  const bool isOBJMaterial = !strcmp(type, "OBJMaterial");
+
+  for (size_t i = 0; i < mat->params.size(); i++) {
+    const Param *p = &mat->params[i];
+    const char *name = p->name;
+
+    switch(p->type) {
+    case Param::INT:
+      ospMat.set(name, p->i[0]);
+      break;
+    case Param::FLOAT: {
+      float f = p->f[0];
+      /* many mtl materials of obj models wrongly store the phong exponent
+         'Ns' in range [0..1], whereas OSPRay's material implementations
+         correctly interpret it to be in [0..inf), thus we map ranges here */
+      if (isOBJMaterial &&
+          (!strcmp(name, "Ns") || !strcmp(name, "ns")) &&
+          f < 1.f) {
+        f = 1.f/(1.f - f) - 1.f;
+      }
+      ospMat.set(name, f);
+    } break;
+    case Param::FLOAT_3:
+     ospMat.set(name, p->f[0], p->f[1], p->f[2]);
+      break;
+    case Param::STRING:
+      ospMat.set(name, p->s);
+      break;
+    case Param::TEXTURE:
+    {
+      miniSG::Texture2D *tex = (miniSG::Texture2D*)p->ptr;
+      if (tex && tex->data) {
+        OSPTexture2D ospTex = createTexture(tex);
+        assert(ospTex);
+        ospMat.set(name, ospTex);
+      }
+      break;
+    }
+    default:
+      throw std::runtime_error("unknown material parameter type");
+    };
+  }
+
+  ospMat.commit();
+  return ospMat;
+}
+
+OSPTexture2D TriangleMeshMaterials::createTexture(miniSG::Texture2D *msgTex)
+{
+  if(msgTex == nullptr || msgTex->data == nullptr)
+  {
+    if (++m_numMissingTextures < 10)
+    {
+      cerr << "WARNING: material does not have Textures"
+           << " (only warning for the first 10 times)!" << endl;
+    }
+    return nullptr;
+  }
+
+  auto known = m_textures.find(msgTex);
+  if (known != m_textures.end())
+    return known->second;
+
+  //TODO: We need to come up with a better way to handle different possible
+  //      pixel layouts
+  OSPTextureFormat type = OSP_TEXTURE_R8;
+
+  if (msgTex->depth == 1) {
+    if( msgTex->channels == 1 ) type = OSP_TEXTURE_R8;
+    if( msgTex->channels == 3 )
+      type = msgTex->prefereLinear ? OSP_TEXTURE_RGB8 : OSP_TEXTURE_SRGB;
+    if( msgTex->channels == 4 )
+      type = msgTex->prefereLinear ? OSP_TEXTURE_RGBA8 : OSP_TEXTURE_SRGBA;
+  } else if (msgTex->depth == 4) {
+    if( msgTex->channels == 1 ) type = OSP_TEXTURE_R32F;
+    if( msgTex->channels == 3 ) type = OSP_TEXTURE_RGB32F;
+    if( msgTex->channels == 4 ) type = OSP_TEXTURE_RGBA32F;
+  }
+
+  OSPTexture2D ospTex = ospNewTexture2D(osp::vec2i{msgTex->width,
+                                                   msgTex->height},
+                                        type,
+                                        msgTex->data);
+
+  m_textures[msgTex] = ospTex;
+
+  ospCommit(ospTex);
+  return ospTex;
+}
+
+void TriangleMeshMaterials::warnMaterial(const std::string &type)
+{
+  if (m_numFailedMaterials[type] == 0)
+  {
+    cerr << "could not create material type '"<<  type <<
+            "'. Replacing with default material." << endl;
+  }
+  m_numFailedMaterials[type]++;
+}
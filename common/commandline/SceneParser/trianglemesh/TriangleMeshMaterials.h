@@ -0,0 +1,83 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include <ospray_cpp/Material.h>
+#include <ospray_cpp/Renderer.h>
+#include <common/miniSG/miniSG.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*! ospray materials and textures created for the miniSG materials of a
+    scene. materials with the same type and parameter values (including
+    the same textures) share a single ospray material, no matter which
+    file or mesh they came from. a scene's LOD proxy and animation time
+    steps share it with the scene. it creates ospray objects, so like the
+    rest of the upload it is only used on the rendering thread */
+class TriangleMeshMaterials
+{
+public:
+  /*! if 'createDefaultMaterial' is false, meshes without a (valid)
+      material get no material at all */
+  TriangleMeshMaterials(ospray::cpp::Renderer renderer,
+                        bool createDefaultMaterial);
+
+  /*! ospray material for 'mat'; the default material if 'mat' is null
+      or of a type the renderer doesn't know */
+  ospray::cpp::Material material(ospray::miniSG::Material *mat);
+
+  /*! committed ospray texture for 'tex', created on first use */
+  OSPTexture2D texture(ospray::miniSG::Texture2D *tex);
+
+  /*! number of distinct ospray materials created so far, and of miniSG
+      materials that got one of those instead of their own */
+  size_t numCreated() const;
+  size_t numDeduplicated() const;
+
+private:
+
+  ospray::cpp::Material defaultMaterial();
+  ospray::cpp::Material createMaterial(ospray::miniSG::Material *mat);
+  OSPTexture2D createTexture(ospray::miniSG::Texture2D *tex);
+  void warnMaterial(const std::string &type);
+
+  // Data //
+
+  ospray::cpp::Renderer m_renderer;
+  bool                  m_createDefaultMaterial;
+  ospray::cpp::Material m_defaultMaterial;
+
+  using CachedMaterial = std::pair<ospcommon::Ref<ospray::miniSG::Material>,
+                                   ospray::cpp::Material>;
+
+  // materials by miniSG material, and by hash of their content; entries
+  // keep their miniSG material alive, so pointers can't get reused
+  std::unordered_map<ospray::miniSG::Material *, CachedMaterial> m_byPointer;
+  std::unordered_map<uint64_t, std::vector<CachedMaterial>>     m_byContent;
+
+  std::unordered_map<ospray::miniSG::Texture2D *, OSPTexture2D> m_textures;
+
+  std::map<std::string, int> m_numFailedMaterials;
+  int    m_numMissingTextures;
+  size_t m_numCreated;
+  size_t m_numDeduplicated;
+};
@@ -18,128 +18,241 @@
 
 #include <ospray_cpp/Data.h>
 
+#include <atomic>
+#include <exception>
+#include <future>
+#include <thread>
+
 using namespace ospray;
 using namespace ospcommon;
 
 #include <iostream>
 using std::cerr;
+using std::cout;
 using std::endl;
 
 // Static local helper functions //////////////////////////////////////////////
 
-static void warnMaterial(const std::string &type)
+static bool isSceneFile(const FileName &fn)
 {
-  static std::map<std::string,int> numOccurances;
-  if (numOccurances[type] == 0)
-  {
-    cerr << "could not create material type '"<<  type <<
-            "'. Replacing with default material." << endl;
-  }
-  numOccurances[type]++;
+  const std::string ext = fn.ext();
+  return ext == "stl" || ext == "msg" || ext == "tri" || ext == "xml" ||
+         ext == "obj" || ext == "hbp" || ext == "x3d" || ext == "astl";
 }
 
-static OSPTexture2D createTexture2D(ospray::miniSG::Texture2D *msgTex)
+/*! import a single scene file into 'model'; returns false if there was
+    nothing to import */
+static bool importFile(miniSG::Model &model, const FileName &fn)
 {
-  if(msgTex == nullptr)
-  {
-    static int numWarnings = 0;
-    if (++numWarnings < 10)
-    {
-      cerr << "WARNING: material does not have Textures"
-           << " (only warning for the first 10 times)!" << endl;
-    }
-    return nullptr;
-  }
-
-  static std::map<ospray::miniSG::Texture2D*,
-      OSPTexture2D> alreadyCreatedTextures;
-  if (alreadyCreatedTextures.find(msgTex) != alreadyCreatedTextures.end())
-    return alreadyCreatedTextures[msgTex];
-
-  //TODO: We need to come up with a better way to handle different possible
-  //      pixel layouts
-  OSPTextureFormat type = OSP_TEXTURE_R8;
-
-  if (msgTex->depth == 1) {
-    if( msgTex->channels == 1 ) type = OSP_TEXTURE_R8;
-    if( msgTex->channels == 3 )
-      type = msgTex->prefereLinear ? OSP_TEXTURE_RGB8 : OSP_TEXTURE_SRGB;
-    if( msgTex->channels == 4 )
-      type = msgTex->prefereLinear ? OSP_TEXTURE_RGBA8 : OSP_TEXTURE_SRGBA;
-  } else if (msgTex->depth == 4) {
-    if( msgTex->channels == 1 ) type = OSP_TEXTURE_R32F;
-    if( msgTex->channels == 3 ) type = OSP_TEXTURE_RGB32F;
-    if( msgTex->channels == 4 ) type = OSP_TEXTURE_RGBA32F;
+  if (fn.ext() == "stl") {
+    miniSG::importSTL(model,fn);
+  } else if (fn.ext() == "msg") {
+    miniSG::importMSG(model,fn);
+  } else if (fn.ext() == "tri") {
+    miniSG::importTRI(model,fn);
+  } else if (fn.ext() == "xml") {
+    miniSG::importRIVL(model,fn);
+  } else if (fn.ext() == "obj") {
+    miniSG::importOBJ(model,fn);
+  } else if (fn.ext() == "hbp") {
+    miniSG::importHBP(model,fn);
+  } else if (fn.ext() == "x3d") {
+    miniSG::importX3D(model,fn);
+  } else if (fn.ext() == "astl") {
+    // only the first time step is part of the scene; the others get
+    // streamed in during playback, see TriangleMeshAnimation
+    const auto timeSteps = miniSG::listSTLAnimation(fn);
+    if (timeSteps.empty()) return false;
+    miniSG::importSTL(model,timeSteps[0]);
+  } else {
+    return false;
   }
-
-  OSPTexture2D ospTex = ospNewTexture2D(osp::vec2i{msgTex->width,
-                                                   msgTex->height},
-                                        type,
-                                        msgTex->data);
-
-  alreadyCreatedTextures[msgTex] = ospTex;
-
-  ospCommit(ospTex);
-  return ospTex;
+  return true;
 }
 
 // SceneParser definitions ////////////////////////////////////////////////////
 
 TriangleMeshSceneParser::TriangleMeshSceneParser(cpp::Renderer renderer) :
+  m_model(nullptr),
   m_renderer(renderer),
   m_alpha(false),
   m_createDefaultMaterial(true),
   m_maxObjectsToConsider((uint32_t)-1),
+  m_regionOfInterest(ospcommon::empty),
   m_forceInstancing(false),
+  m_reorderMeshes(false),
+  m_detectInstances(false),
+  m_generateNormals(false),
+  m_angleWeightedNormals(false),
+  m_maxTrianglesPerBatch(0),
+  m_textureBudget(0),
+  m_uploadMode(COPY_ARRAYS),
+  m_lodRatio(0.f),
+  m_importThreads(0),
+  m_importIOLimit(4),
   m_msgModel(new miniSG::Model)
 {
 }
 
 bool TriangleMeshSceneParser::parse(int ac, const char **&av)
 {
-  bool loadedScene = false;
+  const bool loadedScene = import(readArgs(ac, av));
+  if (loadedScene) finalize(m_buildLOD);
+  return loadedScene;
+}
+
+void TriangleMeshSceneParser::parseOptions(int ac, const char **av)
+{
+  readArgs(ac, av);
+}
+
+bool TriangleMeshSceneParser::import(const std::vector<std::string> &files)
+{
+  m_msgModel->regionOfInterest = m_regionOfInterest;
+
+  if (files.size() == 1)
+    return importFile(*m_msgModel, files[0]);
+  else if (!files.empty())
+    return importFiles(files);
+  return false;
+}
+
+void TriangleMeshSceneParser::upload(
+    std::shared_ptr<TriangleMeshMaterials> materials)
+{
+  m_materials = materials;
+  finalize(false);
+}
+
+/*! read the options into the parser's settings; returns the scene
+    files */
+std::vector<std::string> TriangleMeshSceneParser::readArgs(int ac,
+                                                           const char **av)
+{
+  std::vector<std::string> sceneFiles;
 
   for (int i = 1; i < ac; i++) {
     const std::string arg = av[i];
     if (arg == "--max-objects") {
       m_maxObjectsToConsider = atoi(av[++i]);
+    } else if (arg == "--roi") {
+      m_regionOfInterest.lower.x = atof(av[++i]);
+      m_regionOfInterest.lower.y = atof(av[++i]);
+      m_regionOfInterest.lower.z = atof(av[++i]);
+      m_regionOfInterest.upper.x = atof(av[++i]);
+      m_regionOfInterest.upper.y = atof(av[++i]);
+      m_regionOfInterest.upper.z = atof(av[++i]);
     } else if (arg == "--force-instancing") {
       m_forceInstancing = true;
+    } else if (arg == "--spatial-reorder") {
+      m_reorderMeshes = true;
+    } else if (arg == "--detect-instances") {
+      m_detectInstances = true;
+    } else if (arg == "--generate-normals") {
+      m_generateNormals = true;
+    } else if (arg == "--angle-weighted-normals") {
+      m_generateNormals = true;
+      m_angleWeightedNormals = true;
+    } else if (arg == "--batch-meshes") {
+      m_maxTrianglesPerBatch = atol(av[++i]);
+    } else if (arg == "--texture-budget") {
+      m_textureBudget = size_t(atol(av[++i])) << 20;
+    } else if (arg == "--memory-budget") {
+      // the whole scene gets imported before the upload anyway, so a
+      // budget can't do better than freeing each mesh right after it
+      ++i;
+      cerr << "--memory-budget is gone, using '--upload-mode release'"
+           << endl;
+      m_uploadMode = RELEASE_ARRAYS;
+    } else if (arg == "--upload-mode") {
+      const std::string mode = av[++i];
+      if (mode == "copy")
+        m_uploadMode = COPY_ARRAYS;
+      else if (mode == "share")
+        m_uploadMode = SHARE_ARRAYS;
+      else if (mode == "release")
+        m_uploadMode = RELEASE_ARRAYS;
+      else
+        cerr << "unknown upload mode '" << mode << "', using 'copy'" << endl;
+    } else if (arg == "--lod-ratio") {
+      m_lodRatio = atof(av[++i]);
     } else if (arg == "--alpha") {
       m_alpha = true;
     } else if (arg == "--no-default-material") {
       m_createDefaultMaterial = false;
-    } else {
-      FileName fn = arg;
-      if (fn.ext() == "stl") {
-        miniSG::importSTL(*m_msgModel,fn);
-        loadedScene = true;
-      } else if (fn.ext() == "msg") {
-        miniSG::importMSG(*m_msgModel,fn);
-        loadedScene = true;
-      } else if (fn.ext() == "tri") {
-        miniSG::importTRI(*m_msgModel,fn);
-        loadedScene = true;
-      } else if (fn.ext() == "xml") {
-        miniSG::importRIVL(*m_msgModel,fn);
-        loadedScene = true;
-      } else if (fn.ext() == "obj") {
-        miniSG::importOBJ(*m_msgModel,fn);
-        loadedScene = true;
-      } else if (fn.ext() == "hbp") {
-        miniSG::importHBP(*m_msgModel,fn);
-        loadedScene = true;
-      } else if (fn.ext() == "x3d") {
-        miniSG::importX3D(*m_msgModel,fn);
-        loadedScene = true;
-      } else if (fn.ext() == "astl") {
-        miniSG::importSTL(m_msgAnimation,fn);
-        loadedScene = true;
+    } else if (arg == "--import-threads") {
+      m_importThreads = atoi(av[++i]);
+    } else if (arg == "--import-io-limit") {
+      m_importIOLimit = atoi(av[++i]);
+    } else if (isSceneFile(arg)) {
+      sceneFiles.push_back(arg);
+    }
+  }
+
+  return sceneFiles;
+}
+
+bool TriangleMeshSceneParser::importFiles(const std::vector<std::string> &files)
+{
+  const size_t numFiles = files.size();
+  const int numCores = std::max(1u, std::thread::hardware_concurrency());
+  const int numThreads = std::min<int>(numFiles,
+      m_importThreads > 0 ? m_importThreads : numCores);
+
+  // every file goes into a model of its own, which get merged in command
+  // line order afterwards, so the result doesn't depend on timing
+  std::vector<Ref<miniSG::Model>> fileModel(numFiles);
+  std::vector<char> imported(numFiles, false);
+  std::vector<std::exception_ptr> failure(numFiles);
+
+  miniSG::IOSlots ioSlots(m_importIOLimit);
+  std::atomic<size_t> nextFile(0);
+
+  auto importWorker = [&]() {
+    for (size_t i = nextFile++; i < numFiles; i = nextFile++) {
+      try {
+        fileModel[i] = new miniSG::Model;
+        fileModel[i]->regionOfInterest = m_regionOfInterest;
+        // the importers hold a slot only while reading, including the
+        // files a scene file refers to (.bin, .mtl, textures), so parsing
+        // still runs on all import threads
+        fileModel[i]->ioSlots = &ioSlots;
+        imported[i] = importFile(*fileModel[i], files[i]);
+      } catch (...) {
+        failure[i] = std::current_exception();
       }
     }
+  };
+
+  std::vector<std::thread> workers;
+  for (int i = 0; i < numThreads; i++)
+    workers.emplace_back(importWorker);
+  for (auto &worker : workers)
+    worker.join();
+
+  for (size_t i = 0; i < numFiles; i++)
+    if (failure[i]) std::rethrow_exception(failure[i]);
+
+  // merge
+  bool loadedScene = false;
+  for (size_t i = 0; i < numFiles; i++) {
+    if (!imported[i]) continue;
+    loadedScene = true;
+
+    const miniSG::Model &from = *fileModel[i];
+    const int meshOffset = m_msgModel->mesh.size();
+    for (const auto &mesh : from.mesh)
+      m_msgModel->mesh.push_back(mesh);
+    for (const auto &inst : from.instance)
+      m_msgModel->instance.push_back(miniSG::Instance(inst.meshID + meshOffset,
+                                                      inst.xfm));
+    for (const auto &camera : from.camera)
+      m_msgModel->camera.push_back(camera);
   }
 
-  if (loadedScene) finalize();
+  cout << "#osp:trianglemesh: imported " << numFiles << " files on "
+       << numThreads << " threads" << endl;
+
   return loadedScene;
 }
 
@@ -153,94 +266,57 @@ ospcommon::box3f TriangleMeshSceneParser::bbox() const
   return m_msgModel.ptr->getBBox();
 }
 
-cpp::Material
-TriangleMeshSceneParser::createDefaultMaterial(cpp::Renderer renderer)
+std::shared_ptr<TriangleMeshLOD> TriangleMeshSceneParser::lod() const
 {
-  if(!m_createDefaultMaterial) return nullptr;
-
-  static auto ospMat = cpp::Material(nullptr);
-
-  if (ospMat.handle()) return ospMat;
-
-  ospMat = renderer.newMaterial("OBJMaterial");
+  return m_lod;
+}
 
-  ospMat.set("Kd", .8f, 0.f, 0.f);
-  ospMat.commit();
-  return ospMat;
+SceneHostData TriangleMeshSceneParser::hostData() const
+{
+  return m_hostData;
 }
 
-cpp::Material TriangleMeshSceneParser::createMaterial(cpp::Renderer renderer,
-                                                      miniSG::Material *mat)
+bool TriangleMeshSceneParser::addGeometriesTo(cpp::Model model) const
 {
-  if (mat == nullptr) return createDefaultMaterial(renderer);
+  for (OSPGeometry geometry : m_geometries)
+    model.addGeometry(geometry);
+  return true;
+}
 
-  static std::map<miniSG::Material *, cpp::Material> alreadyCreatedMaterials;
+std::shared_ptr<TriangleMeshMaterials> TriangleMeshSceneParser::materials() const
+{
+  return m_materials;
+}
 
-  if (alreadyCreatedMaterials.find(mat) != alreadyCreatedMaterials.end()) {
-    return alreadyCreatedMaterials[mat];
-  }
+void TriangleMeshSceneParser::setScene(
+    Ref<miniSG::Model> msgModel,
+    std::shared_ptr<TriangleMeshMaterials> materials)
+{
+  m_msgModel  = msgModel;
+  m_materials = materials;
+  finalize(false);
+}
 
-  const char *type = mat->getParam("type", "OBJMaterial");
-  assert(type);
+void TriangleMeshSceneParser::finalize(bool withLOD)
+{
+  m_model = cpp::Model();
+  m_geometries.clear();
 
-  cpp::Material ospMat;
-  try {
-    ospMat = alreadyCreatedMaterials[mat] = renderer.newMaterial(type);
-  } catch (const std::runtime_error &/*e*/) {
-    warnMaterial(type);
-    return createDefaultMaterial(renderer);
+  if (!m_materials) {
+    m_materials = std::make_shared<TriangleMeshMaterials>(
+        m_renderer, m_createDefaultMaterial);
   }
 
-  const bool isOBJMaterial = !strcmp(type, "OBJMaterial");
-
-  for (auto it =  mat->params.begin(); it !=  mat->params.end(); ++it) {
-    const char *name = it->first.c_str();
-    const miniSG::Material::Param *p = it->second.ptr;
-
-    switch(p->type) {
-    case miniSG::Material::Param::INT:
-      ospMat.set(name, p->i[0]);
-      break;
-    case miniSG::Material::Param::FLOAT: {
-      float f = p->f[0];
-      /* many mtl materials of obj models wrongly store the phong exponent
-         'Ns' in range [0..1], whereas OSPRay's material implementations
-         correctly interpret it to be in [0..inf), thus we map ranges here */
-      if (isOBJMaterial &&
-          (!strcmp(name, "Ns") || !strcmp(name, "ns")) &&
-          f < 1.f) {
-        f = 1.f/(1.f - f) - 1.f;
-      }
-      ospMat.set(name, f);
-    } break;
-    case miniSG::Material::Param::FLOAT_3:
-     ospMat.set(name, p->f[0], p->f[1], p->f[2]);
-      break;
-    case miniSG::Material::Param::STRING:
-      ospMat.set(name, p->s);
-      break;
-    case miniSG::Material::Param::TEXTURE:
-    {
-      miniSG::Texture2D *tex = (miniSG::Texture2D*)p->ptr;
-      if (tex) {
-        OSPTexture2D ospTex = createTexture2D(tex);
-        assert(ospTex);
-        ospCommit(ospTex);
-        ospMat.set(name, ospTex);
-      }
-      break;
-    }
-    default:
-      throw std::runtime_error("unknown material parameter type");
-    };
-  }
+  // importers that can't skip geometry outside the region of interest
+  // while reading leave that to here
+  if (!m_regionOfInterest.empty())
+    miniSG::cropToRegion(*m_msgModel, m_regionOfInterest);
 
-  ospMat.commit();
-  return ospMat;
-}
+  // turn duplicate meshes into instances first, so the check below
+  // picks up the instancing path if any were found
+  if (m_detectInstances)
+    miniSG::detectInstances(*m_msgModel);
 
-void TriangleMeshSceneParser::finalize()
-{
   // code does not yet do instancing ... check that the model doesn't
   // contain instances
   bool doesInstancing = 0;
@@ -261,50 +337,124 @@ void TriangleMeshSceneParser::finalize()
     }
   }
 
+  if (m_maxTrianglesPerBatch > 0)
+    miniSG::batchMeshes(*m_msgModel, m_maxTrianglesPerBatch);
+
+  if (m_reorderMeshes)
+    miniSG::reorderForLocality(*m_msgModel);
+
+  if (m_generateNormals)
+    miniSG::generateNormals(*m_msgModel, m_angleWeightedNormals);
+
+  if (m_textureBudget > 0)
+    miniSG::fitTexturesToBudget(*m_msgModel, m_textureBudget);
+
+  const bool shareArrays = m_uploadMode == SHARE_ARRAYS;
+  const uint32_t hostArrayFlags = shareArrays ? OSP_DATA_SHARED_BUFFER : 0;
+
+  // the host arrays are gone once they got released after the upload, so
+  // in that case the proxy's simplification can't wait for the upload
+  Ref<miniSG::Model> lodSource;
+  float lodRatio = m_lodRatio;
+  if (withLOD && m_lodRatio > 0.f && m_lodRatio < 1.f) {
+    if (m_uploadMode == RELEASE_ARRAYS) {
+      lodSource = miniSG::simplify(*m_msgModel, m_lodRatio);
+      lodRatio  = 1.f;
+    } else {
+      lodSource = m_msgModel;
+    }
+  }
+
   std::vector<OSPModel> instanceModels;
 
+  size_t numReleased   = 0;
+  size_t releasedBytes = 0;
+
+  // without instancing, each mesh's transform gets baked into its
+  // vertices; that runs as a background task one mesh ahead, so it
+  // overlaps with the upload of the previous mesh
+  auto preTransform = [&](size_t i) -> std::future<void> {
+    if (doesInstancing || i >= m_msgModel->instance.size() ||
+        m_msgModel->instance[i] == miniSG::Instance(i))
+      return std::future<void>();
+
+    Ref<miniSG::Mesh> mesh = m_msgModel->mesh[i];
+    miniSG::Instance *inst = &m_msgModel->instance[i];
+    return std::async(std::launch::async, [mesh, inst]() {
+      miniSG::transformMesh(*mesh, inst->xfm);
+      // the transform is baked in now, so make sure nothing (bounds, or
+      // a LOD proxy built from this model) applies it again
+      inst->xfm = ospcommon::one;
+    });
+  };
+
+  std::future<void> nextTransform = preTransform(0);
+
   for (size_t i=0;i<m_msgModel->mesh.size();i++) {
     Ref<miniSG::Mesh> msgMesh = m_msgModel->mesh[i];
 
+    if (nextTransform.valid())
+      nextTransform.get();
+    nextTransform = preTransform(i+1);
+
+    // ospray can't take an empty index array; drop such meshes, along
+    // with their instances
+    if (msgMesh->numTriangles() == 0) {
+      if (doesInstancing)
+        instanceModels.push_back(nullptr);
+      continue;
+    }
+
     // create ospray mesh
     auto ospMesh = m_alpha ? cpp::Geometry("alpha_aware_triangle_mesh") :
                              cpp::Geometry("triangles");
 
-    // check if we have to transform the vertices:
-    if (doesInstancing == false &&
-        m_msgModel->instance[i] != miniSG::Instance(i)) {
-      for (size_t vID = 0; vID < msgMesh->position.size(); vID++) {
-        msgMesh->position[vID] = xfmPoint(m_msgModel->instance[i].xfm,
-                                          msgMesh->position[vID]);
-      }
-    }
+    // arrays that live in external memory (eg, a mapped file) get
+    // shared with ospray instead of copied
+    const miniSG::SharedArrays &shared = msgMesh->shared;
+    if (msgMesh->hasSharedArrays())
+      m_hostData.push_back(shared.owner);
 
     // add position array to mesh
-    OSPData position = ospNewData(msgMesh->position.size(),
-                                  OSP_FLOAT3A,
-                                  &msgMesh->position[0]);
+    OSPData position = msgMesh->hasSharedArrays() ?
+        ospNewData(shared.numVertices, OSP_FLOAT3, shared.position,
+                   OSP_DATA_SHARED_BUFFER) :
+        ospNewData(msgMesh->position.size(),
+                   OSP_FLOAT3A,
+                   &msgMesh->position[0],
+                   hostArrayFlags);
     ospMesh.set("position", position);
 
     // add triangle index array to mesh
     if (!msgMesh->triangleMaterialId.empty()) {
       OSPData primMatID = ospNewData(msgMesh->triangleMaterialId.size(),
                                      OSP_INT,
-                                     &msgMesh->triangleMaterialId[0]);
+                                     &msgMesh->triangleMaterialId[0],
+                                     hostArrayFlags);
       ospMesh.set("prim.materialID", primMatID);
     }
 
     // add triangle index array to mesh
-    OSPData index = ospNewData(msgMesh->triangle.size(),
-                               OSP_INT3,
-                               &msgMesh->triangle[0]);
-    assert(msgMesh->triangle.size() > 0);
+    OSPData index = msgMesh->hasSharedArrays() ?
+        ospNewData(shared.numTriangles,
+                   shared.indexStride == 3 ? OSP_INT3 : OSP_INT4, shared.index,
+                   OSP_DATA_SHARED_BUFFER) :
+        ospNewData(msgMesh->triangle.size(),
+                   OSP_INT3,
+                   &msgMesh->triangle[0],
+                   hostArrayFlags);
     ospMesh.set("index", index);
 
     // add normal array to mesh
-    if (!msgMesh->normal.empty()) {
+    if (shared.normal) {
+      OSPData normal = ospNewData(shared.numVertices, OSP_FLOAT3,
+                                  shared.normal, OSP_DATA_SHARED_BUFFER);
+      ospMesh.set("vertex.normal", normal);
+    } else if (!msgMesh->normal.empty()) {
       OSPData normal = ospNewData(msgMesh->normal.size(),
                                   OSP_FLOAT3A,
-                                  &msgMesh->normal[0]);
+                                  &msgMesh->normal[0],
+                                  hostArrayFlags);
       assert(msgMesh->normal.size() > 0);
       ospMesh.set("vertex.normal", normal);
     }
@@ -313,15 +463,21 @@ void TriangleMeshSceneParser::finalize()
     if (!msgMesh->color.empty()) {
       OSPData color = ospNewData(msgMesh->color.size(),
                                  OSP_FLOAT3A,
-                                 &msgMesh->color[0]);
+                                 &msgMesh->color[0],
+                                 hostArrayFlags);
       assert(msgMesh->color.size() > 0);
       ospMesh.set("vertex.color", color);
     }
     // add texcoord array to mesh
-    if (!msgMesh->texcoord.empty()) {
+    if (shared.texcoord) {
+      OSPData texcoord = ospNewData(shared.numVertices, OSP_FLOAT2,
+                                    shared.texcoord, OSP_DATA_SHARED_BUFFER);
+      ospMesh.set("vertex.texcoord", texcoord);
+    } else if (!msgMesh->texcoord.empty()) {
       OSPData texcoord = ospNewData(msgMesh->texcoord.size(),
                                     OSP_FLOAT2,
-                                    &msgMesh->texcoord[0]);
+                                    &msgMesh->texcoord[0],
+                                    hostArrayFlags);
       assert(msgMesh->texcoord.size() > 0);
       ospMesh.set("vertex.texcoord", texcoord);
     }
@@ -332,7 +488,7 @@ void TriangleMeshSceneParser::finalize()
     // add triangle material id array to mesh
     if (msgMesh->materialList.empty()) {
       // we have a single material for this mesh...
-      auto singleMaterial = createMaterial(m_renderer, msgMesh->material.ptr);
+      auto singleMaterial = m_materials->material(msgMesh->material.ptr);
       ospMesh.setMaterial(singleMaterial);
     } else {
       // we have an entire material list, assign that list
@@ -340,21 +496,19 @@ void TriangleMeshSceneParser::finalize()
       std::vector<OSPTexture2D> alphaMaps;
       std::vector<float> alphas;
       for (size_t i = 0; i < msgMesh->materialList.size(); i++) {
-        auto m = createMaterial(m_renderer, msgMesh->materialList[i].ptr);
+        auto m = m_materials->material(msgMesh->materialList[i].ptr);
         auto handle = m.handle();
         materialList.push_back(handle);
 
-        for (miniSG::Material::ParamMap::const_iterator it =
-             msgMesh->materialList[i]->params.begin();
-             it != msgMesh->materialList[i]->params.end(); it++) {
-          const char *name = it->first.c_str();
-          const miniSG::Material::Param *p = it->second.ptr;
+        const miniSG::Material::ParamList &params =
+            msgMesh->materialList[i]->params;
+        for (size_t j = 0; j < params.size(); j++) {
+          const char *name = params[j].name;
+          const miniSG::Material::Param *p = &params[j];
           if(p->type == miniSG::Material::Param::TEXTURE) {
             if(!strcmp(name, "map_kd") || !strcmp(name, "map_Kd")) {
               miniSG::Texture2D *tex = (miniSG::Texture2D*)p->ptr;
-              OSPTexture2D ospTex = createTexture2D(tex);
-              ospCommit(ospTex);
-              alphaMaps.push_back(ospTex);
+              alphaMaps.push_back(m_materials->texture(tex));
             }
           } else if(p->type == miniSG::Material::Param::FLOAT) {
             if(!strcmp(name, "d")) alphas.push_back(p->f[0]);
@@ -390,6 +544,16 @@ void TriangleMeshSceneParser::finalize()
 
     ospMesh.commit();
 
+    if (shareArrays) {
+      // ospray renders from the host arrays, so keep them alive for as
+      // long as the scene is
+      m_hostData.push_back(msgMesh);
+    } else if (m_uploadMode == RELEASE_ARRAYS) {
+      releasedBytes += msgMesh->sizeInBytes();
+      numReleased++;
+      msgMesh->releaseArrays();
+    }
+
     if (doesInstancing) {
       cpp::Model model_i;
       model_i.addGeometry(ospMesh);
@@ -397,17 +561,39 @@ void TriangleMeshSceneParser::finalize()
       instanceModels.push_back(model_i.handle());
     } else {
       m_model.addGeometry(ospMesh);
+      m_geometries.push_back(ospMesh.handle());
     }
   }
 
+  if (numReleased > 0) {
+    cout << "#osp:trianglemesh: freed host copies of " << numReleased
+         << " meshes (" << (releasedBytes >> 20) << "MB) after upload"
+         << endl;
+  }
+
   if (doesInstancing) {
     for (size_t i = 0; i < m_msgModel->instance.size(); i++) {
+      OSPModel instanceModel = instanceModels[m_msgModel->instance[i].meshID];
+      if (!instanceModel)
+        continue;
       OSPGeometry inst =
-          ospNewInstance(instanceModels[m_msgModel->instance[i].meshID],
+          ospNewInstance(instanceModel,
           reinterpret_cast<osp::affine3f&>(m_msgModel->instance[i].xfm));
       m_model.addGeometry(inst);
+      m_geometries.push_back(inst);
     }
   }
 
   m_model.commit();
+
+  if (m_materials->numDeduplicated() > 0) {
+    cout << "#osp:trianglemesh: " << m_materials->numCreated()
+         << " materials, " << m_materials->numDeduplicated()
+         << " duplicates shared" << endl;
+  }
+
+  if (lodSource.ptr) {
+    m_lod = std::make_shared<TriangleMeshLOD>(m_renderer, lodSource, lodRatio,
+                                              m_materials);
+  }
 }
@@ -19,8 +19,12 @@
 #include <common/commandline/SceneParser/SceneParser.h>
 #include <ospray_cpp/Renderer.h>
 #include <common/miniSG/miniSG.h>
+#include "TriangleMeshLOD.h"
+#include "TriangleMeshMaterials.h"
 
+#include <memory>
 #include <string>
+#include <vector>
 
 
 class TriangleMeshSceneParser : public SceneParser
@@ -30,14 +34,33 @@ public:
 
   bool parse(int ac, const char **&av) override;
 
+  /*! the two halves of parse(), for loading on a background thread:
+      import() reads the given scene files into host memory, and makes
+      no ospray calls; upload() then creates the ospray model, and has
+      to run on the thread that renders. scenes loaded this way get no
+      LOD proxy; parseOptions() reads the options (but no scene files)
+      from a command line */
+  void parseOptions(int ac, const char **av);
+  bool import(const std::vector<std::string> &files);
+  void upload(std::shared_ptr<TriangleMeshMaterials> materials = nullptr);
+
   ospray::cpp::Model model() const override;
   ospcommon::box3f   bbox()  const override;
+  std::shared_ptr<TriangleMeshLOD> lod() const override;
+  SceneHostData hostData() const override;
+  bool addGeometriesTo(ospray::cpp::Model model) const override;
 
-private:
+  /*! the ospray materials the scene got uploaded with */
+  std::shared_ptr<TriangleMeshMaterials> materials() const;
 
-  ospray::cpp::Material createDefaultMaterial(ospray::cpp::Renderer renderer);
-  ospray::cpp::Material createMaterial(ospray::cpp::Renderer renderer,
-                                       ospray::miniSG::Material *mat);
+  /*! use an already imported model as the scene, instead of parsing
+      one from the command line; 'materials' can be shared with another
+      scene using the same miniSG materials. like upload(), this has to
+      run on the thread that renders */
+  void setScene(ospcommon::Ref<ospray::miniSG::Model> msgModel,
+                std::shared_ptr<TriangleMeshMaterials> materials = nullptr);
+
+private:
 
   ospray::cpp::Model    m_model;
   ospray::cpp::Renderer m_renderer;
@@ -46,12 +69,60 @@ private:
   bool m_createDefaultMaterial;
   unsigned int m_maxObjectsToConsider;
 
+  // if not empty, only meshes and instances overlapping this box get
+  // loaded (and some importers skip the others before reading them)
+  ospcommon::box3f m_regionOfInterest;
+
   // if turned on, we'll put each triangle mesh into its own instance,
   // no matter what
   bool m_forceInstancing;
 
+  // if turned on, triangles and vertices of each mesh get sorted along a
+  // space filling curve before upload
+  bool m_reorderMeshes;
+
+  // if turned on, meshes that are (translated) copies of each other get
+  // replaced by instances of a single mesh
+  bool m_detectInstances;
+
+  // if turned on, meshes without normals get smooth vertex normals,
+  // weighted by triangle area (or angle, if m_angleWeightedNormals)
+  bool m_generateNormals;
+  bool m_angleWeightedNormals;
+
+  // if non-zero, small non-instanced meshes get merged into geometries of
+  // up to this many triangles
+  size_t m_maxTrianglesPerBatch;
+
+  // if non-zero, textures get downsampled until they fit into this many
+  // bytes
+  size_t m_textureBudget;
+
+  // how mesh arrays get handed to ospray: copied (host arrays stay
+  // around), shared (ospray renders straight from the host arrays, which
+  // then stay alive with the scene), or copied and then freed on the host
+  // right after each mesh got committed, which keeps peak host memory
+  // at about one copy of the scene
+  enum UploadMode { COPY_ARRAYS, SHARE_ARRAYS, RELEASE_ARRAYS };
+  UploadMode m_uploadMode;
+
+  // if non-zero, a proxy with this fraction of the scene's vertices gets
+  // built in the background, for interactive navigation
+  float m_lodRatio;
+
+  // number of files imported at once (zero: one per core), and how many
+  // of them may be reading from disk at the same time
+  int m_importThreads;
+  int m_importIOLimit;
+
   ospcommon::Ref<ospray::miniSG::Model> m_msgModel;
-  std::vector<ospray::miniSG::Model *> m_msgAnimation;
+  SceneHostData                         m_hostData;
+  // what m_model holds directly: meshes, or instances of them
+  std::vector<OSPGeometry>              m_geometries;
+  std::shared_ptr<TriangleMeshLOD>      m_lod;
+  std::shared_ptr<TriangleMeshMaterials> m_materials;
 
-  void finalize();
+  std::vector<std::string> readArgs(int ac, const char **av);
+  bool importFiles(const std::vector<std::string> &files);
+  void finalize(bool withLOD);
 };
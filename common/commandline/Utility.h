@@ -28,16 +28,21 @@
 #include <tuple>
 #include <type_traits>
 
+// the host data is memory the model renders from directly; keep it for
+// as long as the model is in use
 using ParsedOSPObjects = std::tuple<ospcommon::box3f,
                                     ospray::cpp::Model,
                                     ospray::cpp::Renderer,
-                                    ospray::cpp::Camera>;
+                                    ospray::cpp::Camera,
+                                    SceneHostData>;
 
 template <typename RendererParser_T,
           typename CameraParser_T,
           typename SceneParser_T,
           typename LightsParser_T>
-inline ParsedOSPObjects parseCommandLine(int ac, const char **&av)
+inline ParsedOSPObjects parseCommandLine(int ac, const char **&av,
+                                         std::shared_ptr<TriangleMeshLOD> *lod
+                                           = nullptr)
 {
   static_assert(std::is_base_of<RendererParser, RendererParser_T>::value,
                 "RendererParser_T is not a subclass of RendererParser.");
@@ -56,19 +61,25 @@ inline ParsedOSPObjects parseCommandLine(int ac, const char **&av)
   rendererParser.parse(ac, av);
   auto renderer = rendererParser.renderer();
 
+  // without a place to hand the proxy to, nobody would render it
   SceneParser_T sceneParser{rendererParser.renderer()};
+  sceneParser.setBuildLOD(lod != nullptr);
   sceneParser.parse(ac, av);
   auto model = sceneParser.model();
   auto bbox  = sceneParser.bbox();
+  auto hostData = sceneParser.hostData();
+  if (lod) *lod = sceneParser.lod();
 
   LightsParser_T lightsParser(renderer);
   lightsParser.parse(ac, av);
 
-  return std::make_tuple(bbox, model, renderer, camera);
+  return std::make_tuple(bbox, model, renderer, camera, hostData);
 }
 
-inline ParsedOSPObjects parseWithDefaultParsers(int ac, const char**& av)
+inline ParsedOSPObjects parseWithDefaultParsers(int ac, const char**& av,
+                                                std::shared_ptr<TriangleMeshLOD>
+                                                  *lod = nullptr)
 {
   return parseCommandLine<DefaultRendererParser, DefaultCameraParser,
-                          MultiSceneParser, DefaultLightsParser>(ac, av);
+                          MultiSceneParser, DefaultLightsParser>(ac, av, lod);
 }
@@ -15,6 +15,7 @@
 // ======================================================================== //
 
 #include "PLYTriangleMeshFile.h"
+#include "common/miniSG/generateNormals.h"
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -183,9 +184,6 @@ bool PLYTriangleMeshFile::parse()
     // Add to vertices vector with scaling applied.
     vertices.push_back(scale * ospcommon::vec3fa(vertexProperties[xIndex], vertexProperties[yIndex], vertexProperties[zIndex]));
 
-    // Vertex normals will be computed later.
-    vertexNormals.push_back(ospcommon::vec3fa(0.f));
-
     // Use vertex colors if we have them; otherwise default to white (note that the volume renderer currently requires a color for every vertex).
     if(haveVertexColors)
       vertexColors.push_back(1.f/255.f * ospcommon::vec4f(vertexProperties[rIndex], vertexProperties[gIndex], vertexProperties[bIndex], vertexProperties[aIndex]));
@@ -205,17 +203,14 @@ bool PLYTriangleMeshFile::parse()
     exitOnCondition(!in.good(), "error reading face data.");
 
     triangles.push_back(triangle);
-
-    // Add vertex normal contributions.
-    ospcommon::vec3fa triangleNormal = cross(vertices[triangle.y] - vertices[triangle.x], vertices[triangle.z] - vertices[triangle.x]);
-    vertexNormals[triangle.x] += triangleNormal;
-    vertexNormals[triangle.y] += triangleNormal;
-    vertexNormals[triangle.z] += triangleNormal;
   }
 
-  // Normalize vertex normals.
-  for(int i=0; i<vertexNormals.size(); i++)
-    vertexNormals[i] = normalize(vertexNormals[i]);
+  // Compute area-weighted vertex normals (in parallel).
+  vertexNormals.resize(vertices.size());
+  if(!vertices.empty())
+    ospray::miniSG::generateNormals(&vertices[0], vertices.size(), triangles.size(),
+                                    [&](size_t i) { return triangles[i]; },
+                                    &vertexNormals[0]);
 
   if(verbose)
     std::cout << toString() << " done." << std::endl;
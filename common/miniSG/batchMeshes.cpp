@@ -0,0 +1,292 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "miniSG.h"
+// ospcommon
+#include "ospcommon/tasking/parallel_for.h"
+// stl
+#include <map>
+
+namespace ospray {
+  namespace miniSG {
+    using std::cout;
+    using std::endl;
+
+    /*! which optional vertex arrays a mesh has; only meshes with the
+        same layout can go into the same batch */
+    enum {
+      LAYOUT_NORMAL      = (1<<0),
+      LAYOUT_COLOR       = (1<<1),
+      LAYOUT_TEXCOORD    = (1<<2),
+      LAYOUT_NO_MATERIAL = (1<<3),
+      LAYOUT_INVALID     = (1<<4)
+    };
+
+    /*! meshes without any material only go into batches with each
+        other, so a batch's material list never mixes null entries with
+        real materials */
+    static int vertexLayoutOf(const Mesh &mesh)
+    {
+      const size_t numVertices = mesh.numVertices();
+      int layout = 0;
+      if (mesh.hasSharedArrays()) {
+        if (mesh.shared.normal)   layout |= LAYOUT_NORMAL;
+        if (mesh.shared.texcoord) layout |= LAYOUT_TEXCOORD;
+      }
+      if (!mesh.normal.empty())
+        layout |= (mesh.normal.size() == numVertices) ? LAYOUT_NORMAL
+                                                      : LAYOUT_INVALID;
+      if (!mesh.color.empty())
+        layout |= (mesh.color.size() == numVertices) ? LAYOUT_COLOR
+                                                     : LAYOUT_INVALID;
+      if (!mesh.texcoord.empty())
+        layout |= (mesh.texcoord.size() == numVertices) ? LAYOUT_TEXCOORD
+                                                        : LAYOUT_INVALID;
+      if (!mesh.triangleMaterialId.empty() &&
+          (mesh.triangleMaterialId.size() != mesh.numTriangles() ||
+           mesh.materialList.empty()))
+        layout |= LAYOUT_INVALID;
+      if (mesh.materialList.empty()) {
+        if (!mesh.material) layout |= LAYOUT_NO_MATERIAL;
+      } else {
+        for (const auto &mat : mesh.materialList)
+          if (!mat) layout |= LAYOUT_INVALID;
+      }
+      return layout;
+    }
+
+    /*! a set of meshes that get merged into one, along with the
+        transforms of their (single) instances */
+    struct Batch {
+      std::vector<int> meshID;
+      std::vector<affine3f> xfm;
+      size_t numTriangles;
+      size_t numVertices;
+      Ref<Mesh> merged;
+
+      Batch() : numTriangles(0), numVertices(0) {}
+    };
+
+    /*! merge all meshes of the batch into a single mesh, with a
+        material list and per-primitive material IDs */
+    static void mergeBatch(const Model &model, Batch &batch)
+    {
+      Mesh *merged = new Mesh;
+      batch.merged = merged;
+
+      merged->name = "batch";
+      merged->position.reserve(batch.numVertices);
+      merged->triangle.reserve(batch.numTriangles);
+      merged->triangleMaterialId.reserve(batch.numTriangles);
+
+      for (size_t m = 0; m < batch.meshID.size(); m++)
+        model.mesh[batch.meshID[m]]->materialize();
+
+      const Mesh &first = *model.mesh[batch.meshID[0]];
+      if (!first.normal.empty())   merged->normal.reserve(batch.numVertices);
+      if (!first.color.empty())    merged->color.reserve(batch.numVertices);
+      if (!first.texcoord.empty()) merged->texcoord.reserve(batch.numVertices);
+
+      std::map<Material *, uint32_t> materialIDs;
+
+      for (size_t m = 0; m < batch.meshID.size(); m++) {
+        const Mesh &mesh = *model.mesh[batch.meshID[m]];
+        const affine3f &xfm = batch.xfm[m];
+        const bool transformed = !(xfm == affine3f(ospcommon::one));
+        const uint32_t vertexOffset = merged->position.size();
+
+        // vertices, pre-transformed by the mesh's instance
+        if (transformed) {
+          const LinearSpace3f normalXfm = xfm.l.inverse().transposed();
+          for (size_t i = 0; i < mesh.position.size(); i++)
+            merged->position.push_back(xfmPoint(xfm, mesh.position[i]));
+          for (size_t i = 0; i < mesh.normal.size(); i++) {
+            const vec3fa &n = mesh.normal[i];
+            merged->normal.push_back(n.x * normalXfm.vx +
+                                     n.y * normalXfm.vy +
+                                     n.z * normalXfm.vz);
+          }
+        } else {
+          merged->position.insert(merged->position.end(),
+                                  mesh.position.begin(),
+                                  mesh.position.end());
+          merged->normal.insert(merged->normal.end(),
+                                mesh.normal.begin(),
+                                mesh.normal.end());
+        }
+        merged->color.insert(merged->color.end(),
+                             mesh.color.begin(), mesh.color.end());
+        merged->texcoord.insert(merged->texcoord.end(),
+                                mesh.texcoord.begin(), mesh.texcoord.end());
+
+        // triangles, with vertex IDs shifted into the merged arrays
+        for (size_t i = 0; i < mesh.triangle.size(); i++) {
+          Triangle t = mesh.triangle[i];
+          t.v0 += vertexOffset;
+          t.v1 += vertexOffset;
+          t.v2 += vertexOffset;
+          merged->triangle.push_back(t);
+        }
+
+        // material IDs, as indices into the merged material list
+        if (mesh.materialList.empty()) {
+          Material *mat = mesh.material.ptr;
+          if (materialIDs.find(mat) == materialIDs.end()) {
+            materialIDs[mat] = merged->materialList.size();
+            merged->materialList.push_back(mat);
+          }
+          merged->triangleMaterialId.insert(merged->triangleMaterialId.end(),
+                                            mesh.triangle.size(),
+                                            materialIDs[mat]);
+        } else {
+          const uint32_t materialOffset = merged->materialList.size();
+          merged->materialList.insert(merged->materialList.end(),
+                                      mesh.materialList.begin(),
+                                      mesh.materialList.end());
+          if (mesh.triangleMaterialId.empty()) {
+            merged->triangleMaterialId.insert(
+              merged->triangleMaterialId.end(),
+              mesh.triangle.size(), materialOffset);
+          } else {
+            for (size_t i = 0; i < mesh.triangleMaterialId.size(); i++) {
+              merged->triangleMaterialId.push_back(
+                mesh.triangleMaterialId[i] + materialOffset);
+            }
+          }
+        }
+      }
+
+      // a single shared material doesn't need per-primitive IDs
+      if (merged->materialList.size() == 1) {
+        merged->material = merged->materialList[0];
+        merged->materialList.clear();
+        merged->triangleMaterialId.clear();
+      }
+    }
+
+    void batchMeshes(Model &model, size_t maxTrianglesPerBatch)
+    {
+      const size_t numMeshes = model.mesh.size();
+      if (numMeshes < 2 || maxTrianglesPerBatch == 0) return;
+
+      // ------------------------------------------------------------------
+      // find meshes that are not instanced (ie, referenced by exactly
+      // one instance), and small enough to be worth merging
+      // ------------------------------------------------------------------
+      std::vector<int> numRefs(numMeshes, 0);
+      std::vector<int> instanceOf(numMeshes, -1);
+      for (size_t i = 0; i < model.instance.size(); i++) {
+        const int meshID = model.instance[i].meshID;
+        numRefs[meshID]++;
+        instanceOf[meshID] = i;
+      }
+
+      const int notBatched = -1;
+      std::vector<int> batchOf(numMeshes, notBatched);
+      std::vector<Batch> batch;
+      std::map<int, int> openBatchOfLayout;
+
+      for (size_t meshID = 0; meshID < numMeshes; meshID++) {
+        const Mesh &mesh = *model.mesh[meshID];
+        if (numRefs[meshID] != 1) continue;
+        if (mesh.numTriangles() == 0) continue;
+        if (mesh.numTriangles() >= maxTrianglesPerBatch) continue;
+        const int layout = vertexLayoutOf(mesh);
+        if (layout & LAYOUT_INVALID) continue;
+
+        auto open = openBatchOfLayout.find(layout);
+        if (open != openBatchOfLayout.end()) {
+          const Batch &b = batch[open->second];
+          if (b.numTriangles + mesh.numTriangles() > maxTrianglesPerBatch ||
+              b.numVertices + mesh.numVertices() >= (1u<<31)) {
+            openBatchOfLayout.erase(open);
+            open = openBatchOfLayout.end();
+          }
+        }
+        if (open == openBatchOfLayout.end()) {
+          openBatchOfLayout[layout] = batch.size();
+          batch.push_back(Batch());
+        }
+
+        const int batchID = openBatchOfLayout[layout];
+        Batch &b = batch[batchID];
+        b.meshID.push_back(meshID);
+        b.xfm.push_back(model.instance[instanceOf[meshID]].xfm);
+        b.numTriangles += mesh.numTriangles();
+        b.numVertices  += mesh.numVertices();
+        batchOf[meshID] = batchID;
+      }
+
+      // batches with only a single mesh stay as they are
+      for (size_t i = 0; i < batch.size(); i++) {
+        if (batch[i].meshID.size() == 1) {
+          batchOf[batch[i].meshID[0]] = notBatched;
+          batch[i].meshID.clear();
+        }
+      }
+
+      // ------------------------------------------------------------------
+      // merge the batches, in parallel
+      // ------------------------------------------------------------------
+      parallel_for(int(batch.size()), [&](int batchID) {
+        if (!batch[batchID].meshID.empty())
+          mergeBatch(model, batch[batchID]);
+      });
+
+      // ------------------------------------------------------------------
+      // rebuild mesh and instance lists; each batch takes the place of
+      // its first mesh, so non-instanced models keep one instance per
+      // mesh, in mesh order
+      // ------------------------------------------------------------------
+      std::vector<int> newMeshID(numMeshes, -1);
+      std::vector<int> newBatchMeshID(batch.size(), -1);
+      std::vector<Ref<Mesh> > newMesh;
+      size_t numMerged = 0;
+      for (size_t meshID = 0; meshID < numMeshes; meshID++) {
+        const int batchID = batchOf[meshID];
+        if (batchID == notBatched) {
+          newMeshID[meshID] = newMesh.size();
+          newMesh.push_back(model.mesh[meshID]);
+        } else if (batch[batchID].meshID[0] == (int)meshID) {
+          newBatchMeshID[batchID] = newMesh.size();
+          newMesh.push_back(batch[batchID].merged);
+          numMerged += batch[batchID].meshID.size();
+        }
+      }
+
+      std::vector<Instance> newInstance;
+      for (size_t i = 0; i < model.instance.size(); i++) {
+        const int meshID  = model.instance[i].meshID;
+        const int batchID = batchOf[meshID];
+        if (batchID == notBatched) {
+          Instance inst = model.instance[i];
+          inst.meshID = newMeshID[meshID];
+          newInstance.push_back(inst);
+        } else if (batch[batchID].meshID[0] == meshID) {
+          newInstance.push_back(Instance(newBatchMeshID[batchID]));
+        }
+      }
+
+      cout << "#osp:minisg: merged " << numMerged << " meshes into "
+           << (newMesh.size() - (numMeshes - numMerged)) << " batches ("
+           << newMesh.size() << " meshes remaining)" << endl;
+
+      model.mesh.swap(newMesh);
+      model.instance.swap(newInstance);
+    }
+
+  } // ::ospray::minisg
+} // ::ospray
@@ -0,0 +1,63 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+#include "miniSG.h"
+#include "importer.h"
+// ospcommon
+#include "ospcommon/tasking/parallel_for.h"
+
+namespace ospray {
+  namespace miniSG {
+    using std::cout;
+    using std::endl;
+
+    void cropToRegion(Model &model, const box3f &region)
+    {
+      const size_t numMeshes    = model.mesh.size();
+      const size_t numInstances = model.instance.size();
+
+      std::vector<box3f> meshBounds(numMeshes);
+      parallel_for(int(numMeshes), [&](int meshID) {
+        meshBounds[meshID] = model.mesh[meshID]->getBBox();
+      });
+
+      // keep the instances that overlap the region, and renumber the
+      // meshes they use in order of first use
+      std::vector<int>       newMeshID(numMeshes, -1);
+      std::vector<Ref<Mesh>> newMesh;
+      std::vector<Instance>  newInstance;
+      for (size_t i = 0; i < numInstances; i++) {
+        const Instance &inst = model.instance[i];
+        if (!overlaps(xfmBounds(inst.xfm, meshBounds[inst.meshID]), region))
+          continue;
+        if (newMeshID[inst.meshID] < 0) {
+          newMeshID[inst.meshID] = newMesh.size();
+          newMesh.push_back(model.mesh[inst.meshID]);
+        }
+        newInstance.push_back(Instance(newMeshID[inst.meshID], inst.xfm));
+      }
+
+      cout << "#osp:minisg: region of interest keeps " << newInstance.size()
+           << " of " << numInstances << " instances (" << newMesh.size()
+           << " of " << numMeshes << " meshes)" << endl;
+
+      model.mesh.swap(newMesh);
+      model.instance.swap(newInstance);
+    }
+
+  } // ::ospray::minisg
+} // ::ospray
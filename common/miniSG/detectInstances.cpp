@@ -0,0 +1,238 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "miniSG.h"
+// ospcommon
+#include "ospcommon/tasking/parallel_for.h"
+// stl
+#include <unordered_map>
+#include <cmath>
+#include <cstring>
+
+namespace ospray {
+  namespace miniSG {
+    using std::cout;
+    using std::endl;
+
+    /*! 64-bit FNV-1a hash, continued from 'h' */
+    static inline uint64_t hashBytes(const void *data, size_t size,
+                                     uint64_t h = 0xcbf29ce484222325ull)
+    {
+      const unsigned char *bytes = (const unsigned char *)data;
+      for (size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= 0x100000001b3ull;
+      }
+      return h;
+    }
+
+    template<typename T>
+    static inline uint64_t hashArray(const std::vector<T> &array, uint64_t h)
+    {
+      const size_t num = array.size();
+      h = hashBytes(&num, sizeof(num), h);
+      return array.empty() ? h : hashBytes(&array[0], num*sizeof(T), h);
+    }
+
+    /*! vec3fa's fourth component is padding, which importers don't set
+        consistently; so only x, y and z take part */
+    static inline uint64_t hashArray(const std::vector<vec3fa> &array,
+                                     uint64_t h)
+    {
+      const size_t num = array.size();
+      h = hashBytes(&num, sizeof(num), h);
+      for (size_t i = 0; i < num; i++)
+        h = hashBytes(&array[i].x, 3*sizeof(float), h);
+      return h;
+    }
+
+    /*! float with its lowest mantissa bits cleared, so that values
+        differing only by round-off usually hash the same */
+    static inline uint32_t coarseBits(float f)
+    {
+      uint32_t bits;
+      memcpy(&bits, &f, sizeof(bits));
+      return bits & 0xfffff800u;
+    }
+
+    /*! hash everything of a mesh that does not change under a
+        translation: topology, vertex attributes other than position,
+        materials, and the extent of its bounding box */
+    static uint64_t translationInvariantHash(Mesh &mesh)
+    {
+      uint64_t h = hashArray(mesh.triangle, 0xcbf29ce484222325ull);
+      h = hashArray(mesh.normal, h);
+      h = hashArray(mesh.color, h);
+      h = hashArray(mesh.texcoord, h);
+      h = hashArray(mesh.triangleMaterialId, h);
+      h = hashArray(mesh.materialList, h);
+      const Material *mat = mesh.material.ptr;
+      h = hashBytes(&mat, sizeof(mat), h);
+      const size_t numVertices = mesh.position.size();
+      h = hashBytes(&numVertices, sizeof(numVertices), h);
+
+      const box3f bounds = mesh.getBBox();
+      if (!bounds.empty()) {
+        const vec3f extent = bounds.upper - bounds.lower;
+        const uint32_t key[3] = {
+          coarseBits(extent.x), coarseBits(extent.y), coarseBits(extent.z)
+        };
+        h = hashBytes(key, sizeof(key), h);
+      }
+      return h;
+    }
+
+    template<typename T>
+    static inline bool sameArray(const std::vector<T> &a,
+                                 const std::vector<T> &b)
+    {
+      return a.size() == b.size() &&
+        (a.empty() || !memcmp(&a[0], &b[0], a.size()*sizeof(T)));
+    }
+
+    static inline bool sameArray(const std::vector<vec3fa> &a,
+                                 const std::vector<vec3fa> &b)
+    {
+      if (a.size() != b.size()) return false;
+      for (size_t i = 0; i < a.size(); i++)
+        if (a[i].x != b[i].x || a[i].y != b[i].y || a[i].z != b[i].z)
+          return false;
+      return true;
+    }
+
+    /*! check if mesh 'b' is a translated copy of mesh 'a'; if so,
+        return the translation in 'delta' */
+    static bool isTranslatedCopy(const Mesh &a, const Mesh &b, vec3f &delta)
+    {
+      if (a.material.ptr != b.material.ptr) return false;
+      if (a.position.size() != b.position.size()) return false;
+      if (a.position.empty()) return false;
+      if (!sameArray(a.triangle, b.triangle)) return false;
+      if (!sameArray(a.normal, b.normal)) return false;
+      if (!sameArray(a.color, b.color)) return false;
+      if (!sameArray(a.texcoord, b.texcoord)) return false;
+      if (!sameArray(a.triangleMaterialId, b.triangleMaterialId)) return false;
+      if (!sameArray(a.materialList, b.materialList)) return false;
+
+      const vec3f a0 = vec3f(a.position[0]);
+      const vec3f b0 = vec3f(b.position[0]);
+      delta = b0 - a0;
+
+      const vec3f extent = a.bounds.upper - a.bounds.lower;
+      const float magnitude = std::max(std::max(std::fabs(b0.x),
+                                                std::fabs(b0.y)),
+                                       std::fabs(b0.z));
+      const float eps = 1e-5f * (std::max(std::max(extent.x, extent.y),
+                                          extent.z) + magnitude);
+
+      for (size_t i = 1; i < a.position.size(); i++) {
+        const vec3f d = (vec3f(b.position[i]) - b0) - (vec3f(a.position[i]) - a0);
+        if (std::fabs(d.x) > eps || std::fabs(d.y) > eps || std::fabs(d.z) > eps)
+          return false;
+      }
+      return true;
+    }
+
+    void detectInstances(Model &model)
+    {
+      const size_t numMeshes = model.mesh.size();
+      if (numMeshes < 2) return;
+
+      // ------------------------------------------------------------------
+      // hash all meshes (in parallel), and bucket them by hash
+      // ------------------------------------------------------------------
+      std::vector<uint64_t> hash(numMeshes);
+      parallel_for(int(numMeshes), [&](int meshID) {
+        if (!model.mesh[meshID]->hasSharedArrays())
+          hash[meshID] = translationInvariantHash(*model.mesh[meshID]);
+      });
+
+      std::unordered_map<uint64_t, int> bucketOf;
+      std::vector<std::vector<int> > bucket;
+      for (size_t meshID = 0; meshID < numMeshes; meshID++) {
+        // meshes with shared arrays come from formats that do their own
+        // instancing; leave them alone
+        if (model.mesh[meshID]->hasSharedArrays()) continue;
+        auto it = bucketOf.find(hash[meshID]);
+        if (it == bucketOf.end()) {
+          bucketOf[hash[meshID]] = bucket.size();
+          bucket.push_back(std::vector<int>(1, meshID));
+        } else
+          bucket[it->second].push_back(meshID);
+      }
+      bucketOf.clear();
+
+      // ------------------------------------------------------------------
+      // within each bucket, find the first mesh each mesh is a
+      // (translated) copy of; buckets are independent, so do them in
+      // parallel
+      // ------------------------------------------------------------------
+      std::vector<int>   sourceOf(numMeshes);
+      std::vector<vec3f> offsetOf(numMeshes, vec3f(0.f));
+      for (size_t meshID = 0; meshID < numMeshes; meshID++)
+        sourceOf[meshID] = meshID;
+
+      parallel_for(int(bucket.size()), [&](int bucketID) {
+        const std::vector<int> &member = bucket[bucketID];
+        std::vector<int> unique;
+        for (size_t i = 0; i < member.size(); i++) {
+          const Mesh &mesh = *model.mesh[member[i]];
+          for (size_t j = 0; j < unique.size(); j++) {
+            vec3f delta;
+            if (isTranslatedCopy(*model.mesh[unique[j]], mesh, delta)) {
+              sourceOf[member[i]] = unique[j];
+              offsetOf[member[i]] = delta;
+              break;
+            }
+          }
+          if (sourceOf[member[i]] == member[i])
+            unique.push_back(member[i]);
+        }
+      });
+
+      // ------------------------------------------------------------------
+      // redirect instances of duplicates to their source mesh, and drop
+      // meshes that are no longer referenced
+      // ------------------------------------------------------------------
+      size_t numDuplicates = 0;
+      std::vector<int> newMeshID(numMeshes, -1);
+      std::vector<Ref<Mesh> > newMesh;
+      for (size_t meshID = 0; meshID < numMeshes; meshID++) {
+        if (sourceOf[meshID] == (int)meshID) {
+          newMeshID[meshID] = newMesh.size();
+          newMesh.push_back(model.mesh[meshID]);
+        } else
+          numDuplicates++;
+      }
+
+      if (numDuplicates == 0) return;
+
+      for (size_t i = 0; i < model.instance.size(); i++) {
+        Instance &inst = model.instance[i];
+        const int meshID = inst.meshID;
+        if (sourceOf[meshID] != meshID)
+          inst.xfm = inst.xfm * affine3f::translate(offsetOf[meshID]);
+        inst.meshID = newMeshID[sourceOf[meshID]];
+      }
+      model.mesh.swap(newMesh);
+
+      cout << "#osp:minisg: found " << numDuplicates << " duplicate meshes;"
+           << " now " << model.mesh.size() << " unique meshes in "
+           << model.instance.size() << " instances" << endl;
+    }
+
+  } // ::ospray::minisg
+} // ::ospray
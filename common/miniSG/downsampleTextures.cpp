@@ -0,0 +1,187 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "miniSG.h"
+// ospcommon
+#include "ospcommon/tasking/parallel_for.h"
+// stl
+#include <algorithm>
+#include <queue>
+#include <set>
+#include <string>
+#include <type_traits>
+
+namespace ospray {
+  namespace miniSG {
+    using std::cout;
+    using std::endl;
+
+    static inline size_t sizeOf(const Texture2D &tex, int width, int height)
+    {
+      return size_t(width) * height * tex.channels * tex.depth;
+    }
+
+    static inline size_t sizeOf(const Texture2D &tex)
+    {
+      return sizeOf(tex, tex.width, tex.height);
+    }
+
+    /*! 2x2 box filter from 'src' into 'dst'; with an odd size, the
+        last row/column gets averaged into the last output row/column,
+        which thus covers three of them */
+    template<typename T>
+    static void boxFilter(const T *src, int srcWidth, int srcHeight,
+                          T *dst, int dstWidth, int dstHeight,
+                          int channels)
+    {
+      std::vector<float> sum(channels);
+      for (int y = 0; y < dstHeight; y++) {
+        const int y0 = 2*y;
+        const int y1 = (y == dstHeight-1) ? srcHeight-1 : 2*y+1;
+        for (int x = 0; x < dstWidth; x++) {
+          const int x0 = 2*x;
+          const int x1 = (x == dstWidth-1) ? srcWidth-1 : 2*x+1;
+          std::fill(sum.begin(), sum.end(), 0.f);
+          for (int sy = y0; sy <= y1; sy++) {
+            for (int sx = x0; sx <= x1; sx++) {
+              const T *t = src + (size_t(sy)*srcWidth + sx)*channels;
+              for (int c = 0; c < channels; c++)
+                sum[c] += float(t[c]);
+            }
+          }
+          const float weight = 1.f / ((y1-y0+1) * (x1-x0+1));
+          T *out = dst + (size_t(y)*dstWidth + x)*channels;
+          for (int c = 0; c < channels; c++) {
+            const float avg = sum[c] * weight;
+            out[c] = T(std::is_integral<T>::value ? avg + .5f : avg);
+          }
+        }
+      }
+    }
+
+    /*! replace the texture by a version with half its width and height */
+    static void downsample(Texture2D &tex)
+    {
+      const int width  = std::max(1, tex.width/2);
+      const int height = std::max(1, tex.height/2);
+      std::vector<unsigned char> texels(sizeOf(tex, width, height));
+
+      if (tex.depth == 1) {
+        boxFilter((const unsigned char *)tex.data, tex.width, tex.height,
+                  &texels[0], width, height, tex.channels);
+      } else {
+        boxFilter((const float *)tex.data, tex.width, tex.height,
+                  (float *)&texels[0], width, height, tex.channels);
+      }
+
+      tex.texels.swap(texels);
+      tex.data   = &tex.texels[0];
+      tex.width  = width;
+      tex.height = height;
+    }
+
+    static void addTextures(Material *mat,
+                            std::set<Texture2D *> &found,
+                            std::vector<Texture2D *> &textures)
+    {
+      if (!mat) return;
+      for (size_t i = 0; i < mat->params.size(); i++) {
+        const Material::Param *p = &mat->params[i];
+        if (p->type != Material::Param::TEXTURE) continue;
+        Texture2D *tex = (Texture2D *)p->ptr;
+        if (!tex || !tex->data) continue;
+        if (tex->depth != 1 && tex->depth != 4) continue;
+        if (found.insert(tex).second)
+          textures.push_back(tex);
+      }
+    }
+
+    void fitTexturesToBudget(Model &model, size_t budgetInBytes)
+    {
+      // ------------------------------------------------------------------
+      // gather all textures used by the model's materials
+      // ------------------------------------------------------------------
+      std::set<Texture2D *> found;
+      std::vector<Texture2D *> textures;
+      for (size_t i = 0; i < model.mesh.size(); i++) {
+        const Mesh &mesh = *model.mesh[i];
+        addTextures(mesh.material.ptr, found, textures);
+        for (size_t j = 0; j < mesh.materialList.size(); j++)
+          addTextures(mesh.materialList[j].ptr, found, textures);
+      }
+
+      size_t totalSize = 0;
+      for (size_t i = 0; i < textures.size(); i++)
+        totalSize += sizeOf(*textures[i]);
+      const size_t originalSize = totalSize;
+
+      if (totalSize <= budgetInBytes) return;
+
+      // ------------------------------------------------------------------
+      // pick mip levels: keep halving whichever texture is currently the
+      // largest, until everything fits
+      // ------------------------------------------------------------------
+      std::vector<int> level(textures.size(), 0);
+      std::vector<vec2i> size(textures.size());
+      std::priority_queue<std::pair<size_t, int> > largest;
+      for (size_t i = 0; i < textures.size(); i++) {
+        size[i] = vec2i(textures[i]->width, textures[i]->height);
+        largest.push(std::make_pair(sizeOf(*textures[i]), int(i)));
+      }
+
+      while (totalSize > budgetInBytes && !largest.empty()) {
+        const int i = largest.top().second;
+        largest.pop();
+        if (size[i].x == 1 && size[i].y == 1) continue;
+
+        const Texture2D &tex = *textures[i];
+        const size_t oldSize = sizeOf(tex, size[i].x, size[i].y);
+        size[i] = vec2i(std::max(1, size[i].x/2), std::max(1, size[i].y/2));
+        const size_t newSize = sizeOf(tex, size[i].x, size[i].y);
+        totalSize -= oldSize - newSize;
+        level[i]++;
+        largest.push(std::make_pair(newSize, i));
+      }
+
+      // ------------------------------------------------------------------
+      // downsample, one texture per task
+      // ------------------------------------------------------------------
+      std::vector<vec2i> originalRes(textures.size());
+      for (size_t i = 0; i < textures.size(); i++)
+        originalRes[i] = vec2i(textures[i]->width, textures[i]->height);
+
+      parallel_for(int(textures.size()), [&](int i) {
+        for (int l = 0; l < level[i]; l++)
+          downsample(*textures[i]);
+      });
+
+      for (size_t i = 0; i < textures.size(); i++) {
+        if (level[i] == 0) continue;
+        const std::string &fileName = textures[i]->fileName;
+        cout << "#osp:minisg: texture "
+             << (fileName.empty() ? "#" + std::to_string(i) : fileName)
+             << ": "
+             << originalRes[i].x << "x" << originalRes[i].y << " -> "
+             << textures[i]->width << "x" << textures[i]->height
+             << " (mip level " << level[i] << ")" << endl;
+      }
+      cout << "#osp:minisg: textures use " << (totalSize >> 20) << "MB"
+           << " (was " << (originalSize >> 20) << "MB, budget "
+           << (budgetInBytes >> 20) << "MB)" << endl;
+    }
+
+  } // ::ospray::minisg
+} // ::ospray
@@ -0,0 +1,67 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "miniSG.h"
+#include "generateNormals.h"
+
+namespace ospray {
+  namespace miniSG {
+    using std::cout;
+    using std::endl;
+
+    void generateNormals(Mesh &mesh, bool angleWeighted)
+    {
+      const size_t numVertices  = mesh.numVertices();
+      const size_t numTriangles = mesh.numTriangles();
+      mesh.normal.resize(numVertices);
+
+      if (mesh.hasSharedArrays()) {
+        const SharedArrays &shared = mesh.shared;
+        auto getTriangle = [&](size_t i) {
+          const int32_t *index = shared.index + i*shared.indexStride;
+          return vec3i(index[0], index[1], index[2]);
+        };
+        generateNormals(shared.position, numVertices, numTriangles,
+                        getTriangle, &mesh.normal[0], angleWeighted);
+      } else {
+        auto getTriangle = [&](size_t i) {
+          const Triangle &t = mesh.triangle[i];
+          return vec3i(t.v0, t.v1, t.v2);
+        };
+        generateNormals(&mesh.position[0], numVertices, numTriangles,
+                        getTriangle, &mesh.normal[0], angleWeighted);
+      }
+    }
+
+    void generateNormals(Model &model, bool angleWeighted)
+    {
+      size_t numGenerated = 0;
+      for (size_t i = 0; i < model.mesh.size(); i++) {
+        Mesh &mesh = *model.mesh[i];
+        const bool hasNormals = mesh.hasSharedArrays()
+          ? mesh.shared.normal != nullptr || !mesh.normal.empty()
+          : mesh.normal.size() == mesh.position.size();
+        if (hasNormals || mesh.numVertices() == 0) continue;
+        generateNormals(mesh, angleWeighted);
+        numGenerated++;
+      }
+      if (numGenerated > 0)
+        cout << "#osp:minisg: generated normals for " << numGenerated
+             << " meshes" << endl;
+    }
+
+  } // ::ospray::minisg
+} // ::ospray
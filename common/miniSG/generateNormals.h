@@ -0,0 +1,190 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file generateNormals.h Vertex normal generation for indexed
+    triangle meshes, independent of how vertices and triangles are
+    stored */
+
+// ospcommon
+#include "ospcommon/vec.h"
+#include "ospcommon/tasking/parallel_for.h"
+// stl
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+#ifdef __SSE__
+#  include <xmmintrin.h>
+#endif
+
+namespace ospray {
+  namespace miniSG {
+
+    /*! normalize 'num' normals in place; zero-length normals stay zero.
+        four normals at a time get transposed into x/y/z registers, so
+        the lengths are computed with full-width SIMD */
+    inline void normalizeNormals(ospcommon::vec3fa *normal, size_t num)
+    {
+      size_t i = 0;
+#ifdef __SSE__
+      for (; i+4 <= num; i += 4) {
+        float *n = (float *)&normal[i];
+        __m128 x = _mm_loadu_ps(n+0);
+        __m128 y = _mm_loadu_ps(n+4);
+        __m128 z = _mm_loadu_ps(n+8);
+        __m128 w = _mm_loadu_ps(n+12);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        const __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x),
+                                                  _mm_mul_ps(y, y)),
+                                       _mm_mul_ps(z, z));
+        const __m128 valid = _mm_cmpgt_ps(len2, _mm_setzero_ps());
+        const __m128 rcpLen = _mm_and_ps(valid,
+          _mm_div_ps(_mm_set1_ps(1.f), _mm_sqrt_ps(len2)));
+        x = _mm_mul_ps(x, rcpLen);
+        y = _mm_mul_ps(y, rcpLen);
+        z = _mm_mul_ps(z, rcpLen);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        _mm_storeu_ps(n+0,  x);
+        _mm_storeu_ps(n+4,  y);
+        _mm_storeu_ps(n+8,  z);
+        _mm_storeu_ps(n+12, w);
+      }
+#endif
+      for (; i < num; i++) {
+        const float len = length(ospcommon::vec3f(normal[i]));
+        if (len > 0.f) normal[i] = normal[i] * (1.f/len);
+      }
+    }
+
+    /*! compute per-vertex normals as the sum of the normals of all
+        triangles using the vertex, weighted by triangle area, or (if
+        'angleWeighted') by the triangle's angle at that vertex.
+        'position[i]' must convert to vec3f, and 'getTriangle(i)' must
+        return the vertex IDs of triangle 'i' as a vec3i.
+
+        all steps run in parallel: face normals are computed per
+        triangle, then each vertex gathers the normals of its
+        triangles from a vertex-to-triangle table, so there are no
+        conflicting writes, and results don't depend on scheduling */
+    template<typename Position, typename GetTriangle>
+    void generateNormals(const Position *position, size_t numVertices,
+                         size_t numTriangles, const GetTriangle &getTriangle,
+                         ospcommon::vec3fa *normal, bool angleWeighted = false)
+    {
+      using namespace ospcommon;
+      if (numVertices == 0) return;
+
+      const size_t blockSize = 1<<14;
+      const int numTriBlocks = int((numTriangles + blockSize-1) / blockSize);
+      const int numVtxBlocks = int((numVertices  + blockSize-1) / blockSize);
+
+      // ------------------------------------------------------------------
+      // unnormalized face normals (their length is twice the area), and
+      // the number of triangles using each vertex
+      // ------------------------------------------------------------------
+      std::vector<vec3f> faceNormal(numTriangles);
+      std::vector<std::atomic<uint32_t> > count(numVertices);
+      parallel_for(numVtxBlocks, [&](int blockID) {
+        const size_t end = std::min(numVertices, (blockID+1)*blockSize);
+        for (size_t i = blockID*blockSize; i < end; i++) count[i] = 0;
+      });
+      parallel_for(numTriBlocks, [&](int blockID) {
+        const size_t end = std::min(numTriangles, (blockID+1)*blockSize);
+        for (size_t i = blockID*blockSize; i < end; i++) {
+          const vec3i t = getTriangle(i);
+          const vec3f v0 = vec3f(position[t.x]);
+          const vec3f v1 = vec3f(position[t.y]);
+          const vec3f v2 = vec3f(position[t.z]);
+          faceNormal[i] = cross(v1-v0, v2-v0);
+          count[t.x]++;
+          count[t.y]++;
+          count[t.z]++;
+        }
+      });
+
+      // ------------------------------------------------------------------
+      // vertex-to-triangle table: the triangles of vertex 'i' are
+      // vtxTriangle[begin[i]..begin[i+1])
+      // ------------------------------------------------------------------
+      std::vector<size_t> begin(numVertices+1);
+      begin[0] = 0;
+      for (size_t i = 0; i < numVertices; i++) {
+        begin[i+1] = begin[i] + count[i];
+        count[i] = 0;
+      }
+
+      std::vector<uint32_t> vtxTriangle(begin[numVertices]);
+      parallel_for(numTriBlocks, [&](int blockID) {
+        const size_t end = std::min(numTriangles, (blockID+1)*blockSize);
+        for (size_t i = blockID*blockSize; i < end; i++) {
+          const vec3i t = getTriangle(i);
+          vtxTriangle[begin[t.x] + count[t.x]++] = uint32_t(i);
+          vtxTriangle[begin[t.y] + count[t.y]++] = uint32_t(i);
+          vtxTriangle[begin[t.z] + count[t.z]++] = uint32_t(i);
+        }
+      });
+      std::vector<std::atomic<uint32_t> >().swap(count);
+
+      // ------------------------------------------------------------------
+      // gather, per vertex; sorting each vertex's (short) triangle list
+      // makes the summation order deterministic
+      // ------------------------------------------------------------------
+      parallel_for(numVtxBlocks, [&](int blockID) {
+        const size_t end = std::min(numVertices, (blockID+1)*blockSize);
+        for (size_t i = blockID*blockSize; i < end; i++) {
+          uint32_t *tri = vtxTriangle.data() + begin[i];
+          uint32_t *triEnd = vtxTriangle.data() + begin[i+1];
+          std::sort(tri, triEnd);
+
+          vec3f sum(0.f);
+          for (; tri != triEnd; tri++) {
+            const vec3f &n = faceNormal[*tri];
+            if (!angleWeighted) {
+              sum += n;
+              continue;
+            }
+
+            const vec3i t = getTriangle(*tri);
+            const vec3f p  = vec3f(position[i]);
+            const vec3f a  = vec3f(position[size_t(t.x) == i ? t.y : t.x]);
+            const vec3f b  = vec3f(position[size_t(t.z) == i ? t.y : t.z]);
+            const vec3f e0 = a - p;
+            const vec3f e1 = b - p;
+            const float len2 = dot(e0,e0) * dot(e1,e1);
+            const float nLen = length(n);
+            if (len2 <= 0.f || nLen <= 0.f) continue;
+            const float cosAngle = dot(e0,e1) / std::sqrt(len2);
+            const float angle = std::acos(std::max(-1.f, std::min(1.f, cosAngle)));
+            sum += n * (angle / nLen);
+          }
+          normal[i] = vec3fa(sum);
+        }
+      });
+
+      // ------------------------------------------------------------------
+      // normalize
+      // ------------------------------------------------------------------
+      parallel_for(numVtxBlocks, [&](int blockID) {
+        const size_t first = blockID*blockSize;
+        const size_t end   = std::min(numVertices, first+blockSize);
+        normalizeNormals(normal + first, end - first);
+      });
+    }
+
+  } // ::ospray::minisg
+} // ::ospray
@@ -16,33 +16,49 @@
 
 #include "miniSG.h"
 #include "importer.h"
-#include <fstream>
 
 namespace ospray {
   namespace miniSG {
     using std::cout;
     using std::endl;
 
-    /*! import a HBP file, and add it to the specified model */
+    /*! keeps both files of a HBP model mapped */
+    struct HBPFiles : public RefCount
+    {
+      Ref<MappedFile> vtx; /*!< packed vec3f vertex positions */
+      Ref<MappedFile> tri; /*!< packed triples of int32 vertex IDs */
+    };
+
+    /*! import a HBP file, and add it to the specified model. both
+        arrays already are in a layout ospray understands, so they stay
+        in the mapped files and get shared with ospray as they are */
     void importHBP(Model &model, const ospcommon::FileName &fileName)
     {
-      std::string vtxName = fileName.str()+".vtx";
-      std::string triName = fileName.str()+".tri";
-      FILE *vtx = fopen(vtxName.c_str(),"rb");
-      FILE *tri = fopen(triName.c_str(),"rb");
+      Ref<HBPFiles> files = new HBPFiles;
+      files->vtx = new MappedFile(fileName.str()+".vtx", model.ioSlots);
+      files->tri = new MappedFile(fileName.str()+".tri", model.ioSlots);
+
+      if (files->vtx->size % sizeof(vec3f) != 0)
+        error("HBP vertex file '"+fileName.str()+".vtx' is truncated");
+      if (files->tri->size % sizeof(Triangle) != 0)
+        error("HBP triangle file '"+fileName.str()+".tri' is truncated");
 
       Mesh *mesh = new Mesh;
-      vec3f v; 
-      Triangle t;
-
-      while (fread(&v,sizeof(v),1,vtx))
-        mesh->position.push_back(vec3fa(v));
-      while (fread(&t,sizeof(t),1,tri))
-        mesh->triangle.push_back(t);
-      
+      mesh->shared.owner        = files.ptr;
+      mesh->shared.position     = (const vec3f *)files->vtx->data;
+      mesh->shared.index        = (const int32_t *)files->tri->data;
+      mesh->shared.indexStride  = 3;
+      mesh->shared.numVertices  = files->vtx->size / sizeof(vec3f);
+      mesh->shared.numTriangles = files->tri->size / sizeof(Triangle);
+      mesh->material = NULL;
+      padSharedPositions(*mesh, *files->vtx);
+
       model.mesh.push_back(mesh);
       model.instance.push_back(Instance(model.mesh.size()-1));
-      mesh->material = NULL; 
+
+      cout << "#osp:minisg: mapped HBP model with "
+           << mesh->shared.numVertices << " vertices and "
+           << mesh->shared.numTriangles << " triangles" << endl;
     }
 
   } // ::ospray::minisg
@@ -16,7 +16,7 @@
 
 #include "miniSG.h"
 #include "importer.h"
-#include <fstream>
+#include <istream>
 #include <cmath>
 #include <string>
 
@@ -147,13 +147,13 @@ namespace ospray {
       path(fileName.path()),
       curMaterial(nullptr)
     {
-      /* open file */
-      std::ifstream cin;
-      cin.open(fileName.c_str());
-      if (!cin.is_open()) {
+      /* open file; it gets read in large pieces, within the I/O limit */
+      LimitedFileBuffer file(fileName.str(), model.ioSlots);
+      if (!file.isOpen()) {
         std::cerr << "cannot open " << fileName.str() << std::endl;
         return;
       }
+      std::istream cin(&file);
 
       // /* generate default material */
       defaultMaterial = nullptr;
@@ -224,7 +224,6 @@ namespace ospray {
           // ignore unknown stuff
         }
       flushFaceGroup();
-      cin.close();
     }
     
     OBJLoader::~OBJLoader()
@@ -234,12 +233,12 @@ namespace ospray {
     /* load material file */
     void OBJLoader::loadMTL(const ospcommon::FileName &fileName)
     {
-      std::ifstream cin;
-      cin.open(fileName.c_str());
-      if (!cin.is_open()) {
+      LimitedFileBuffer file(fileName.str(), model.ioSlots);
+      if (!file.isOpen()) {
         std::cerr << "cannot open " << fileName.str() << std::endl;
         return;
       }
+      std::istream cin(&file);
 
       char line[10000];
       memset(line, 0, sizeof(line));
@@ -298,17 +297,17 @@ namespace ospray {
           if (!strncmp(token, "Ks", 2)) { parseSep(token += 2);  cur->setParam("Ks", getVec3f(token)); continue; }
           if (!strncmp(token, "Tf", 2)) { parseSep(token += 2);  cur->setParam("Tf", getVec3f(token)); continue; }
 
-          if (!strncmp(token, "map_d" , 5)) { parseSepOpt(token += 5);  cur->setParam("map_d", loadTexture(path, std::string(token), true),Material::Param::TEXTURE);  continue; }
-          if (!strncmp(token, "map_Ns" , 6)) { parseSepOpt(token += 6); cur->setParam("map_Ns", loadTexture(path, std::string(token), true),Material::Param::TEXTURE);  continue; }
-          if (!strncmp(token, "map_Ka" , 6)) { parseSepOpt(token += 6); cur->setParam("map_Ka", loadTexture(path, std::string(token)),Material::Param::TEXTURE);  continue; }
-          if (!strncmp(token, "map_Kd" , 6)) { parseSepOpt(token += 6); cur->setParam("map_Kd", loadTexture(path, std::string(token)),Material::Param::TEXTURE);  continue; }
-          if (!strncmp(token, "map_Ks" , 6)) { parseSepOpt(token += 6); cur->setParam("map_Ks", loadTexture(path, std::string(token)),Material::Param::TEXTURE);  continue; }
+          if (!strncmp(token, "map_d" , 5)) { parseSepOpt(token += 5);  cur->setParam("map_d", loadTexture(path, std::string(token), true, model.ioSlots),Material::Param::TEXTURE);  continue; }
+          if (!strncmp(token, "map_Ns" , 6)) { parseSepOpt(token += 6); cur->setParam("map_Ns", loadTexture(path, std::string(token), true, model.ioSlots),Material::Param::TEXTURE);  continue; }
+          if (!strncmp(token, "map_Ka" , 6)) { parseSepOpt(token += 6); cur->setParam("map_Ka", loadTexture(path, std::string(token), false, model.ioSlots),Material::Param::TEXTURE);  continue; }
+          if (!strncmp(token, "map_Kd" , 6)) { parseSepOpt(token += 6); cur->setParam("map_Kd", loadTexture(path, std::string(token), false, model.ioSlots),Material::Param::TEXTURE);  continue; }
+          if (!strncmp(token, "map_Ks" , 6)) { parseSepOpt(token += 6); cur->setParam("map_Ks", loadTexture(path, std::string(token), false, model.ioSlots),Material::Param::TEXTURE);  continue; }
           /*! the following are extensions to the standard */
-          if (!strncmp(token, "map_Refl" , 8)) { parseSepOpt(token += 8);  cur->setParam("map_Refl", loadTexture(path, std::string(token)),Material::Param::TEXTURE);  continue; }
-          if (!strncmp(token, "map_Bump" , 8)) { parseSepOpt(token += 8);  cur->setParam("map_Bump", loadTexture(path, std::string(token), true),Material::Param::TEXTURE);  continue; }
+          if (!strncmp(token, "map_Refl" , 8)) { parseSepOpt(token += 8);  cur->setParam("map_Refl", loadTexture(path, std::string(token), false, model.ioSlots),Material::Param::TEXTURE);  continue; }
+          if (!strncmp(token, "map_Bump" , 8)) { parseSepOpt(token += 8);  cur->setParam("map_Bump", loadTexture(path, std::string(token), true, model.ioSlots),Material::Param::TEXTURE);  continue; }
 
-          if (!strncmp(token, "bumpMap" , 7)) { parseSepOpt(token += 7);  cur->setParam("map_Bump", loadTexture(path, std::string(token), true),Material::Param::TEXTURE);  continue; }
-          if (!strncmp(token, "colorMap" , 8)) { parseSepOpt(token += 8);  cur->setParam("map_Kd", loadTexture(path, std::string(token)),Material::Param::TEXTURE);  continue; }
+          if (!strncmp(token, "bumpMap" , 7)) { parseSepOpt(token += 7);  cur->setParam("map_Bump", loadTexture(path, std::string(token), true, model.ioSlots),Material::Param::TEXTURE);  continue; }
+          if (!strncmp(token, "colorMap" , 8)) { parseSepOpt(token += 8);  cur->setParam("map_Kd", loadTexture(path, std::string(token), false, model.ioSlots),Material::Param::TEXTURE);  continue; }
 
           if (!strncmp(token, "color", 5)) { parseSep(token += 5);  cur->setParam("color", getVec3f(token)); continue; }
           if (!strncmp(token, "type", 4)) { parseSep(token += 4);  cur->type = std::string(token); cur->setParam("type", token); continue; }
@@ -321,7 +320,6 @@ namespace ospray {
           cur->setParam(ident, getFloat(token));
         }
       // if (cur) g_device->rtCommit(cur);
-      cin.close();
     }
 
     /*! handles relative indices and starts indexing from 0 */
@@ -422,6 +420,9 @@ namespace ospray {
                    const ospcommon::FileName &fileName)
     {
       OBJLoader(model,fileName);
+      // textures referenced by the .mtl files were decoded while we
+      // parsed the geometry
+      waitForTextures();
     }
 
   } // ::ospray::minisg
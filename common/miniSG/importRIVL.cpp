@@ -16,29 +16,21 @@
 
 #undef NDEBUG
 
-// O_LARGEFILE is a GNU extension.
-#ifdef __APPLE__
-#define  O_LARGEFILE  0
-#endif
-
 #define WARN_ON_INCLUDING_OSPCOMMON 1
 
 // header
 #include "miniSG.h"
+#include "importer.h"
 // stl
+#include <future>
+#include <list>
 #include <map>
 #include <sstream>
 // libxml
-#include "common/xml/XML.h"
-// stdlib, for mmap
-#include <sys/types.h>
-#include <sys/stat.h>
-#ifdef _WIN32
-#  include <windows.h>
-#else
-#  include <sys/mman.h>
-#endif
-#include <fcntl.h>
+#include "common/xml/XMLStream.h"
+#include "common/xml/NumberParser.h"
+// ospcommon
+#include "ospcommon/tasking/parallel_for.h"
 #include <string>
 #include <cstring>
 
@@ -49,12 +41,21 @@ namespace ospray {
     using std::cout;
     using std::endl;
 
-    //! base pointer to mmapped binary file (that all offsets are relative to)
-    unsigned char *binBasePtr = nullptr;
-
     /*! Base class for all scene graph node types */
     struct Node : public ospcommon::RefCount
     {
+      /*! node types the scene graph traversal cares about; lets it
+          dispatch without a chain of dynamic_casts */
+      typedef enum {
+        OTHER,
+        GROUP,
+        TRANSFORM,
+        CAMERA,
+        TRIANGLE_MESH,
+      } Kind;
+
+      Node(Kind kind = OTHER) : kind(kind) {}
+
       virtual string toString() const { return "ospray::miniSG::Node"; } 
 
       /*! \brief create a new instance of given type, and parse its
@@ -69,6 +70,7 @@ namespace ospray {
       */
 
       std::string name;
+      Kind kind;
     };
 
     /*! Abstraction for a 'material' that a renderer can query from
@@ -80,12 +82,14 @@ namespace ospray {
     };
 
     struct RIVLCamera : public miniSG::Node {
+      RIVLCamera() : Node(CAMERA) {}
       virtual string toString() const { return "ospray::miniSG::RIVLCamera"; } 
       vec3f from, at, up;
     };
 
     /*! Scene graph grouping node */
     struct Group : public miniSG::Node {
+      Group() : Node(GROUP) {}
       virtual string toString() const;
       std::vector<Ref<miniSG::Node> > child;
     };
@@ -93,6 +97,7 @@ namespace ospray {
     /*! scene graph node that contains an ospray geometry type (i.e.,
       anything that defines some sort of geometric surface */
     struct Geometry : public miniSG::Node {
+      Geometry(Kind kind = OTHER) : Node(kind) {}
       std::vector<Ref<RIVLMaterial> > material;
       virtual string toString() const { return "ospray::miniSG::Geometry"; } 
     };
@@ -107,6 +112,7 @@ namespace ospray {
     /*! scene graph node that contains an ospray geometry type (i.e.,
       anything that defines some sort of geometric surface */
     struct Transform : public miniSG::Node {
+      Transform() : Node(TRANSFORM) {}
       Ref<miniSG::Node> child;
       affine3f xfm;
       virtual string toString() const { return "ospray::miniSG::Transform"; } 
@@ -149,10 +155,45 @@ namespace ospray {
       size_t numTexCoords;
     };
 
-    std::vector<Ref<miniSG::Node> > nodeList;
+    /*! a batch of meshes getting converted in the background */
+    struct EarlyConversion {
+      std::vector<TriangleMesh *> mesh;
+      std::vector<Ref<Mesh> >     converted;
+      std::future<void>           done;
+    };
+
+    /*! state of a single RIVL import; there is no global state, so
+        several files can get imported at the same time */
+    struct RIVLImport {
+      //! mmapped binary file, kept alive by meshes and textures that
+      //! point into it
+      Ref<MappedFile> binFile;
+      //! base pointer to mmapped binary file (that all offsets are relative to)
+      unsigned char *binBasePtr;
+      //! all nodes parsed so far, in file order (nodes refer to each
+      //! other by index into this list)
+      std::vector<Ref<miniSG::Node> > nodeList;
+      //! last mesh or group parsed, which is the root of the scene graph
+      Ref<miniSG::Node> lastNode;
+
+      //! if set, meshes get converted to miniSG meshes in the
+      //! background as soon as they have been parsed, while the rest of
+      //! the file is still being read
+      bool convertEarly;
+      //! meshes parsed, but not handed to a background conversion yet
+      std::vector<TriangleMesh *> unconverted;
+      //! background conversions; declared last, so that they get waited
+      //! for before anything they use goes away
+      std::list<EarlyConversion> earlyConversions;
+      //! if set, limits the reads of the xml and binary files
+      IOSlots *ioSlots;
+
+      RIVLImport() : binBasePtr(nullptr), convertEarly(false), ioSlots(nullptr) {}
+    };
 
     TriangleMesh::TriangleMesh()
-      : triangle(nullptr),
+      : Geometry(TRIANGLE_MESH),
+        triangle(nullptr),
         numTriangles(0),
         vertex(nullptr),
         numVertices(0),
@@ -187,536 +228,496 @@ namespace ospray {
       return ss.str();
     } 
     
-    Ref<miniSG::Node> parseBGFscene(xml::Node *root)
+    /*! all numbers in an xml node's content; long lists (such as the
+        children of a large group) get parsed in parallel */
+    template<typename T>
+    std::vector<T> numbersIn(const xml::StringRef &content)
     {
-      std::string rootName = root->name;
-      if (rootName != "BGFscene")
-        throw std::runtime_error("XML file is not a RIVL model !?");
-      if (root->child.empty())
-        throw std::runtime_error("emply RIVL model !?");
+      std::vector<T> values;
+      xml::parseNumberList(content.begin(), content.end(), values);
+      return values;
+    }
 
-      Ref<miniSG::Node> lastNode;
-      for (size_t childID = 0; childID < root->child.size(); childID++) {
-        xml::Node *node = root->child[childID];
-        std::string nodeName = node->name;
-        if (nodeName == "text") {
-          // -------------------------------------------------------
-        } else if (nodeName == "Texture2D") {
-          // -------------------------------------------------------
-          Ref<miniSG::RIVLTexture> txt = new miniSG::RIVLTexture;
-          txt.ptr->texData = new miniSG::Texture2D;
-          nodeList.push_back(txt.ptr);
-
-          int height = -1, width = -1, ofs = -1, channels = -1, depth = -1;
-          std::string format;
-
-          for (size_t pID = 0; pID < node->prop.size(); pID++) {
-            xml::Prop *prop = node->prop[pID];
-            if (prop->name == "ofs") {
-              ofs = atol(prop->value.c_str());
-            } else if (prop->name == "width") {
-              width = atol(prop->value.c_str());
-            } else if (prop->name == "height") {
-              height = atol(prop->value.c_str());
-            } else if (prop->name == "channels") {
-              channels = atol(prop->value.c_str());
-            } else if (prop->name == "depth") {
-              depth = atol(prop->value.c_str());
-            } else if (prop->name == "format") {
-              format = prop->value.c_str();
-            }
+    /*! parse one child of the BGFscene root node, and append what it
+        describes to the import's node list */
+    void parseBGFnode(RIVLImport &import, xml::ArenaNode *node)
+    {
+      std::vector<Ref<miniSG::Node> > &nodeList = import.nodeList;
+      unsigned char *binBasePtr = import.binBasePtr;
+      Ref<miniSG::Node> &lastNode = import.lastNode;
+
+      std::string nodeName = node->name;
+      if (nodeName == "text") {
+        // -------------------------------------------------------
+      } else if (nodeName == "Texture2D") {
+        // -------------------------------------------------------
+        Ref<miniSG::RIVLTexture> txt = new miniSG::RIVLTexture;
+        txt.ptr->texData = new miniSG::Texture2D;
+        nodeList.push_back(txt.ptr);
+
+        int height = -1, width = -1, ofs = -1, channels = -1, depth = -1;
+        std::string format;
+
+        for (size_t pID = 0; pID < node->prop.size(); pID++) {
+          xml::ArenaProp *prop = node->prop[pID];
+          if (prop->name == "ofs") {
+            ofs = atol(prop->value.c_str());
+          } else if (prop->name == "width") {
+            width = atol(prop->value.c_str());
+          } else if (prop->name == "height") {
+            height = atol(prop->value.c_str());
+          } else if (prop->name == "channels") {
+            channels = atol(prop->value.c_str());
+          } else if (prop->name == "depth") {
+            depth = atol(prop->value.c_str());
+          } else if (prop->name == "format") {
+            format = prop->value.c_str();
           }
-          assert(ofs != -1
-                 && "Offset not properly parsed for Texture2D nodes");
-          assert(width != -1
-                 && "Width not properly parsed for Texture2D nodes");
-          assert(height != -1
-                 && "Height not properly parsed for Texture2D nodes");
-          assert(channels != -1
-                 && "Channel count not properly parsed for Texture2D nodes");
-          assert(depth != -1
-                 && "Depth not properly parsed for Texture2D nodes");
-          assert(strcmp(format.c_str(), "") != 0
-                 && "Format not properly parsed for Texture2D nodes");
-
-          txt.ptr->texData->channels = channels;
-          txt.ptr->texData->depth = depth;
-          txt.ptr->texData->prefereLinear = true;
-          txt.ptr->texData->width = width;
-          txt.ptr->texData->height = height;
-          if (channels == 4) { // RIVL bin stores alpha channel inverted, fix here
-            size_t sz = width * height;
-            if (depth == 1) { // char
-              vec4uc *texel = new vec4uc[sz];
-              memcpy(texel, binBasePtr+ofs, sz*sizeof(vec4uc));
-              for (size_t p = 0; p < sz; p++)
-                texel[p].w = 255 - texel[p].w; 
-              txt.ptr->texData->data = texel;
-            } else { // float
-              vec4f *texel = new vec4f[sz];
-              memcpy(texel, binBasePtr+ofs, sz*sizeof(vec4f));
-              for (size_t p = 0; p < sz; p++)
-                texel[p].w = 1.0f - texel[p].w; 
-              txt.ptr->texData->data = texel;
-            }
-          } else
-            txt.ptr->texData->data = (char*)(binBasePtr+ofs);
-
-          // -------------------------------------------------------
-        } else if (nodeName == "Material") {
-          // -------------------------------------------------------
-          Ref<miniSG::RIVLMaterial> RIVLmat = new miniSG::RIVLMaterial;
-          RIVLmat.ptr->general = new miniSG::Material;
-          nodeList.push_back(RIVLmat.ptr);
-
-          miniSG::Material *mat = RIVLmat.ptr->general.ptr;
-
-          std::string name;
-          std::string type;
-
-          for (size_t pID = 0; pID < node->prop.size(); pID++) {
-            xml::Prop *prop = node->prop[pID];
-            if (prop->name == "name") {
-              name = prop->value;
-              mat->setParam("name", name.c_str());
-              mat->name = name;
-            } else if (prop->name == "type") {
-              type = prop->value;
-              mat->setParam("type", type.c_str());
-            }
+        }
+        assert(ofs != -1
+               && "Offset not properly parsed for Texture2D nodes");
+        assert(width != -1
+               && "Width not properly parsed for Texture2D nodes");
+        assert(height != -1
+               && "Height not properly parsed for Texture2D nodes");
+        assert(channels != -1
+               && "Channel count not properly parsed for Texture2D nodes");
+        assert(depth != -1
+               && "Depth not properly parsed for Texture2D nodes");
+        assert(strcmp(format.c_str(), "") != 0
+               && "Format not properly parsed for Texture2D nodes");
+
+        txt.ptr->texData->channels = channels;
+        txt.ptr->texData->depth = depth;
+        txt.ptr->texData->prefereLinear = true;
+        txt.ptr->texData->width = width;
+        txt.ptr->texData->height = height;
+        if (channels == 4) { // RIVL bin stores alpha channel inverted, fix here
+          size_t sz = width * height;
+          std::vector<unsigned char> &texels = txt.ptr->texData->texels;
+          if (depth == 1) { // char
+            texels.resize(sz*sizeof(vec4uc));
+            vec4uc *texel = (vec4uc*)&texels[0];
+            memcpy(texel, binBasePtr+ofs, sz*sizeof(vec4uc));
+            for (size_t p = 0; p < sz; p++)
+              texel[p].w = 255 - texel[p].w; 
+            txt.ptr->texData->data = texel;
+          } else { // float
+            texels.resize(sz*sizeof(vec4f));
+            vec4f *texel = (vec4f*)&texels[0];
+            memcpy(texel, binBasePtr+ofs, sz*sizeof(vec4f));
+            for (size_t p = 0; p < sz; p++)
+              texel[p].w = 1.0f - texel[p].w; 
+            txt.ptr->texData->data = texel;
           }
+        } else {
+          txt.ptr->texData->data = (char*)(binBasePtr+ofs);
+          txt.ptr->texData->owner = import.binFile.ptr;
+        }
 
-          for (size_t childID = 0; childID < node->child.size(); childID++) {
-            xml::Node *child = node->child[childID];
-            std::string childNodeType = child->name;
-
-            if (!childNodeType.compare("param")) {
-              std::string childName;
-              std::string childType;
-
-              for (size_t pID = 0; pID < child->prop.size(); pID++) {
-                xml::Prop *prop = child->prop[pID];
-                if (prop->name == "name") {
-                  childName = prop->value;
-                } else if (prop->name == "type") { 
-                  childType = prop->value;
-                }
-              }
+        // -------------------------------------------------------
+      } else if (nodeName == "Material") {
+        // -------------------------------------------------------
+        Ref<miniSG::RIVLMaterial> RIVLmat = new miniSG::RIVLMaterial;
+        RIVLmat.ptr->general = new miniSG::Material;
+        nodeList.push_back(RIVLmat.ptr);
+
+        miniSG::Material *mat = RIVLmat.ptr->general.ptr;
+
+        std::string name;
+        std::string type;
+
+        for (size_t pID = 0; pID < node->prop.size(); pID++) {
+          xml::ArenaProp *prop = node->prop[pID];
+          if (prop->name == "name") {
+            name = prop->value;
+            mat->setParam("name", name.c_str());
+            mat->name = name;
+          } else if (prop->name == "type") {
+            type = prop->value;
+            mat->setParam("type", type.c_str());
+          }
+        }
 
-              //Get the data out of the node
-              char *value = strdup(child->content.c_str());
-#define NEXT_TOK strtok(nullptr, " \t\n\r")
-              char *s = strtok((char*)value, " \t\n\r");
-              //TODO: UGLY! Find a better way.
-              if (!childType.compare("float")) {
-                mat->setParam(childName.c_str(), (float)atof(s));
-              } else if (!childType.compare("float2")) {
-                float x = atof(s);
-                s = NEXT_TOK;
-                float y = atof(s);
-                mat->setParam(childName.c_str(), vec2f(x,y));
-              } else if (!childType.compare("float3")) {
-                float x = atof(s);
-                s = NEXT_TOK;
-                float y = atof(s);
-                s = NEXT_TOK;
-                float z = atof(s);
-                mat->setParam(childName.c_str(), vec3f(x,y,z));
-              } else if (!childType.compare("float4")) {
-                float x = atof(s);
-                s = NEXT_TOK;
-                float y = atof(s);
-                s = NEXT_TOK;
-                float z = atof(s);
-                s = NEXT_TOK;
-                float w = atof(s);
-                mat->setParam(childName.c_str(), vec4f(x,y,z,w));
-              } else if (!childType.compare("int")) {
-                //This *could* be a texture, handle it!
-                if(childName.find("map_") == std::string::npos) {
-                  mat->setParam(childName.c_str(), (int32_t)atol(s));
-                } else {
-                  Texture2D* tex = mat->textures[(int32_t)atol(s)].ptr;
-                  mat->setParam(childName.c_str(), (void*)tex, Material::Param::TEXTURE);
-                }
-              } else if (!childType.compare("int2")) {
-                int32_t x = atol(s);
-                s = NEXT_TOK;
-                int32_t y = atol(s);
-                mat->setParam(childName.c_str(), vec2i(x,y));
-              } else if (!childType.compare("int3")) {
-                int32_t x = atol(s);
-                s = NEXT_TOK;
-                int32_t y = atol(s);
-                s = NEXT_TOK;
-                int32_t z = atol(s);
-                mat->setParam(childName.c_str(), vec3i(x,y,z));
-              } else if (!childType.compare("int4")) {
-                int32_t x = atol(s);
-                s = NEXT_TOK;
-                int32_t y = atol(s);
-                s = NEXT_TOK;
-                int32_t z = atol(s);
-                s = NEXT_TOK;
-                int32_t w = atol(s);
-                mat->setParam(childName.c_str(), vec4i(x,y,z,w));
-              } else {
-                //error!
-                throw std::runtime_error("unknown parameter type '" + childType + "' when parsing RIVL materials.");
-              }
-              free(value);
-            } else if (!childNodeType.compare("textures")) {
-              int num = -1;
-              for (size_t pID = 0; pID < child->prop.size(); pID++) {
-                xml::Prop *prop = child->prop[pID];
-                if (prop->name == "num") {
-                  num = atol(prop->value.c_str());
-                }
+        for (size_t childID = 0; childID < node->child.size(); childID++) {
+          xml::ArenaNode *child = node->child[childID];
+          std::string childNodeType = child->name;
+
+          if (!childNodeType.compare("param")) {
+            std::string childName;
+            std::string childType;
+
+            for (size_t pID = 0; pID < child->prop.size(); pID++) {
+              xml::ArenaProp *prop = child->prop[pID];
+              if (prop->name == "name") {
+                childName = prop->value;
+              } else if (prop->name == "type") { 
+                childType = prop->value;
               }
+            }
 
-              if (child->content == "") {
+            //Get the data out of the node
+            const bool isInt = !childType.compare(0, 3, "int");
+            std::vector<float>   f;
+            std::vector<int32_t> i;
+            if (isInt)
+              i = numbersIn<int32_t>(child->content);
+            else
+              f = numbersIn<float>(child->content);
+            auto expect = [&](size_t num) {
+              if (f.size() + i.size() < num)
+                throw std::runtime_error("too few values for parameter '"
+                                         + childName + "' when parsing RIVL"
+                                         " materials.");
+            };
+
+            if (!childType.compare("float")) {
+              expect(1);
+              mat->setParam(childName.c_str(), f[0]);
+            } else if (!childType.compare("float2")) {
+              expect(2);
+              mat->setParam(childName.c_str(), vec2f(f[0],f[1]));
+            } else if (!childType.compare("float3")) {
+              expect(3);
+              mat->setParam(childName.c_str(), vec3f(f[0],f[1],f[2]));
+            } else if (!childType.compare("float4")) {
+              expect(4);
+              mat->setParam(childName.c_str(), vec4f(f[0],f[1],f[2],f[3]));
+            } else if (!childType.compare("int")) {
+              expect(1);
+              //This *could* be a texture, handle it!
+              if(childName.find("map_") == std::string::npos) {
+                mat->setParam(childName.c_str(), i[0]);
               } else {
-                char *tokenBuffer = strdup(child->content.c_str());
-                
-                char *s = strtok(tokenBuffer, " \t\n\r");
-                while (s) {
-                  int texID = atoi(s);
-                  RIVLTexture * tex = nodeList[texID].cast<RIVLTexture>().ptr;
-                  mat->textures.push_back(tex->texData);
-                  s = NEXT_TOK;
-                }
-                free(tokenBuffer);
+                Texture2D* tex = mat->textures[i[0]].ptr;
+                mat->setParam(childName.c_str(), (void*)tex, Material::Param::TEXTURE);
               }
-              if (mat->textures.size() != static_cast<size_t>(num)) {
-                throw std::runtime_error("invalid number of textures in"
-                                         " material (found either more or less"
-                                         " than the 'num' field specifies");
+            } else if (!childType.compare("int2")) {
+              expect(2);
+              mat->setParam(childName.c_str(), vec2i(i[0],i[1]));
+            } else if (!childType.compare("int3")) {
+              expect(3);
+              mat->setParam(childName.c_str(), vec3i(i[0],i[1],i[2]));
+            } else if (!childType.compare("int4")) {
+              expect(4);
+              mat->setParam(childName.c_str(), vec4i(i[0],i[1],i[2],i[3]));
+            } else {
+              //error!
+              throw std::runtime_error("unknown parameter type '" + childType + "' when parsing RIVL materials.");
+            }
+          } else if (!childNodeType.compare("textures")) {
+            int num = -1;
+            for (size_t pID = 0; pID < child->prop.size(); pID++) {
+              xml::ArenaProp *prop = child->prop[pID];
+              if (prop->name == "num") {
+                num = atol(prop->value.c_str());
               }
             }
+
+            for (int texID : numbersIn<int>(child->content)) {
+              RIVLTexture * tex = nodeList[texID].cast<RIVLTexture>().ptr;
+              mat->textures.push_back(tex->texData);
+            }
+            if (mat->textures.size() != static_cast<size_t>(num)) {
+              throw std::runtime_error("invalid number of textures in"
+                                       " material (found either more or less"
+                                       " than the 'num' field specifies");
+            }
           }
-#undef NEXT_TOK
-          // -------------------------------------------------------
-        } else if (nodeName == "Camera") {
-          // -------------------------------------------------------
-          Ref<miniSG::RIVLCamera> camera = new miniSG::RIVLCamera;
-          nodeList.push_back(camera.ptr);
-
-          // parse values
-          for (size_t pID = 0; pID < node->child.size(); pID++) {
-            xml::Node *childNode = node->child[pID];
-            if (childNode->name == "from") {
-              sscanf(childNode->content.c_str(),"%f %f %f",
-                     &camera->from.x,&camera->from.y,&camera->from.z);
-            }   
-            if (childNode->name == "at") {
-              sscanf(childNode->content.c_str(),"%f %f %f",
-                     &camera->at.x,&camera->at.y,&camera->at.z);
-            }   
-            if (childNode->name == "up") {
-              sscanf(childNode->content.c_str(),"%f %f %f",
-                     &camera->up.x,&camera->up.y,&camera->up.z);
-            }   
-          }    
-          // -------------------------------------------------------
-        } else if (nodeName == "Transform") {
-          // -------------------------------------------------------
-          Ref<miniSG::Transform> xfm = new miniSG::Transform;
-          nodeList.push_back(xfm.ptr);
-
-          // find child ID
-          for (size_t pID = 0;pID < node->prop.size(); pID++) {
-            xml::Prop *prop = node->prop[pID];
-            if (prop->name == "child") {
-              size_t childID = atoi(prop->value.c_str());
-              miniSG::Node *child = nodeList[childID].ptr;
-              assert(child);
-              xfm->child = child;
-            }   
-          }    
-            
-          // parse xfm matrix
-          int numRead = sscanf((char*)node->content.c_str(),
-                               "%f %f %f\n%f %f %f\n%f %f %f\n%f %f %f",
-                               &xfm->xfm.l.vx.x,
-                               &xfm->xfm.l.vx.y,
-                               &xfm->xfm.l.vx.z,
-                               &xfm->xfm.l.vy.x,
-                               &xfm->xfm.l.vy.y,
-                               &xfm->xfm.l.vy.z,
-                               &xfm->xfm.l.vz.x,
-                               &xfm->xfm.l.vz.y,
-                               &xfm->xfm.l.vz.z,
-                               &xfm->xfm.p.x,
-                               &xfm->xfm.p.y,
-                               &xfm->xfm.p.z);
-          if (numRead != 12)  {
-            throw std::runtime_error("invalid number of elements in RIVL"
-                                     " transform node");
-          }
+        }
+        // -------------------------------------------------------
+      } else if (nodeName == "Camera") {
+        // -------------------------------------------------------
+        Ref<miniSG::RIVLCamera> camera = new miniSG::RIVLCamera;
+        nodeList.push_back(camera.ptr);
+
+        // parse values
+        for (size_t pID = 0; pID < node->child.size(); pID++) {
+          xml::ArenaNode *childNode = node->child[pID];
+          const std::vector<float> v = numbersIn<float>(childNode->content);
+          if (v.size() < 3)
+            continue;
+          if (childNode->name == "from")
+            camera->from = vec3f(v[0],v[1],v[2]);
+          if (childNode->name == "at")
+            camera->at = vec3f(v[0],v[1],v[2]);
+          if (childNode->name == "up")
+            camera->up = vec3f(v[0],v[1],v[2]);
+        }    
+        // -------------------------------------------------------
+      } else if (nodeName == "Transform") {
+        // -------------------------------------------------------
+        Ref<miniSG::Transform> xfm = new miniSG::Transform;
+        nodeList.push_back(xfm.ptr);
+
+        // find child ID
+        for (size_t pID = 0;pID < node->prop.size(); pID++) {
+          xml::ArenaProp *prop = node->prop[pID];
+          if (prop->name == "child") {
+            size_t childID = atoi(prop->value.c_str());
+            miniSG::Node *child = nodeList[childID].ptr;
+            assert(child);
+            xfm->child = child;
+          }   
+        }    
           
-          // -------------------------------------------------------
-        } else if (nodeName == "Mesh") {
-          // -------------------------------------------------------
-          Ref<miniSG::TriangleMesh> mesh = new miniSG::TriangleMesh;
-          nodeList.push_back(mesh.ptr);
-
-          for (size_t childID = 0; childID < node->child.size(); childID++) {
-            xml::Node *child = node->child[childID];
-            std::string childType = child->name;
-            if (childType == "text") {
-            } else if (childType == "vertex") {
-              size_t ofs = -1, num = -1;
-              // scan parameters ...
-              for (size_t pID = 0; pID < child->prop.size(); pID++) {
-                xml::Prop *prop = child->prop[pID];
-                if (prop->name == "ofs") {
-                  ofs = atol(prop->value.c_str());
-                }       
-                else if (prop->name == "num") {
-                  num = atol(prop->value.c_str());
-                }       
-              }
-              assert(ofs != size_t(-1));
-              assert(num != size_t(-1));
-              mesh->numVertices = num;
-              mesh->vertex = (vec3f*)(binBasePtr+ofs);
-            } else if (childType == "normal") {
-              size_t ofs = -1, num = -1;
-              // scan parameters ...
-              for (size_t pID = 0; pID < child->prop.size(); pID++) {
-                xml::Prop *prop = child->prop[pID];
-                if (prop->name == "ofs"){
-                  ofs = atol(prop->value.c_str());
-                }       
-                else if (prop->name == "num") {
-                  num = atol(prop->value.c_str());
-                }       
-              }
-              assert(ofs != size_t(-1));
-              assert(num != size_t(-1));
-              mesh->numNormals = num;
-              mesh->normal = (vec3f*)(binBasePtr+ofs);
-            } else if (childType == "texcoord") {
-              size_t ofs = -1, num = -1;
-              // scan parameters ...
-              for (size_t pID = 0; pID < child->prop.size(); pID++) {
-                xml::Prop *prop = child->prop[pID];
-                if (prop->name == "ofs") {
-                  ofs = atol(prop->value.c_str());
-                }       
-                else if (prop->name == "num") {
-                  num = atol(prop->value.c_str());
-                }       
-              }
-              assert(ofs != size_t(-1));
-              assert(num != size_t(-1));
-              mesh->numTexCoords = num;
-              mesh->texCoord = (vec2f*)(binBasePtr+ofs);
-            } else if (childType == "prim") {
-              size_t ofs = -1, num = -1;
-              // scan parameters ...
-              for (size_t pID = 0; pID < child->prop.size(); pID++) {
-                xml::Prop *prop = child->prop[pID];
-                if (prop->name == "ofs") {
-                  ofs = atol(prop->value.c_str());
-                }       
-                else if (prop->name == "num") {
-                  num = atol(prop->value.c_str());
-                }       
-              }
-              assert(ofs != size_t(-1));
-              assert(num != size_t(-1));
-              mesh->numTriangles = num;
-              mesh->triangle = (vec4i*)(binBasePtr+ofs);
-            } else if (childType == "materiallist") {
-              char* value = strdup(child->content.c_str());
-              for(char *s=strtok((char*)value," \t\n\r");
-                  s;
-                  s=strtok(nullptr," \t\n\r")) {
-                size_t matID = atoi(s);
-                Ref<RIVLMaterial> mat = nodeList[matID].cast<miniSG::RIVLMaterial>();
-                mat.ptr->refInc();
-                assert(mat.ptr);
-                mesh->material.push_back(mat);
-              }
-              free(value);
-              //xmlFree(value);
-            } else {
-              throw std::runtime_error("unknown child node type '"+childType+"' for mesh node");
+        // parse xfm matrix
+        const std::vector<float> v = numbersIn<float>(node->content);
+        if (v.size() < 12)  {
+          throw std::runtime_error("invalid number of elements in RIVL"
+                                   " transform node");
+        }
+        xfm->xfm.l.vx = vec3f(v[0],v[1],v[2]);
+        xfm->xfm.l.vy = vec3f(v[3],v[4],v[5]);
+        xfm->xfm.l.vz = vec3f(v[6],v[7],v[8]);
+        xfm->xfm.p    = vec3f(v[9],v[10],v[11]);
+        
+        // -------------------------------------------------------
+      } else if (nodeName == "Mesh") {
+        // -------------------------------------------------------
+        Ref<miniSG::TriangleMesh> mesh = new miniSG::TriangleMesh;
+        nodeList.push_back(mesh.ptr);
+
+        for (size_t childID = 0; childID < node->child.size(); childID++) {
+          xml::ArenaNode *child = node->child[childID];
+          std::string childType = child->name;
+          if (childType == "text") {
+          } else if (childType == "vertex") {
+            size_t ofs = -1, num = -1;
+            // scan parameters ...
+            for (size_t pID = 0; pID < child->prop.size(); pID++) {
+              xml::ArenaProp *prop = child->prop[pID];
+              if (prop->name == "ofs") {
+                ofs = atol(prop->value.c_str());
+              }       
+              else if (prop->name == "num") {
+                num = atol(prop->value.c_str());
+              }       
             }
-          }
-          // std::cout << "Found mesh " << mesh->toString() << std::endl;
-          lastNode = mesh.ptr;
-          // -------------------------------------------------------
-        } else if (nodeName == "Group") {
-          // -------------------------------------------------------
-          Ref<miniSG::Group> group = new miniSG::Group;
-          nodeList.push_back(group.ptr);
-          // xmlChar* value = xmlNodeListGetString(node->doc, node->children, 1);
-          if (node->content == "")
-            // empty group...
-            ;
-          // std::cout << "warning: xmlNodeListGetString(...) returned nullptr" << std::endl;
-          else {
-            char *value = strdup(node->content.c_str());
-            for(char *s=strtok((char*)value," \t\n\r");s;s=strtok(nullptr," \t\n\r")) {
-              size_t childID = atoi(s);
-              miniSG::Node *child = nodeList[childID].ptr;
-              //assert(child);
-              group->child.push_back(child);
+            assert(ofs != size_t(-1));
+            assert(num != size_t(-1));
+            mesh->numVertices = num;
+            mesh->vertex = (vec3f*)(binBasePtr+ofs);
+          } else if (childType == "normal") {
+            size_t ofs = -1, num = -1;
+            // scan parameters ...
+            for (size_t pID = 0; pID < child->prop.size(); pID++) {
+              xml::ArenaProp *prop = child->prop[pID];
+              if (prop->name == "ofs"){
+                ofs = atol(prop->value.c_str());
+              }       
+              else if (prop->name == "num") {
+                num = atol(prop->value.c_str());
+              }       
+            }
+            assert(ofs != size_t(-1));
+            assert(num != size_t(-1));
+            mesh->numNormals = num;
+            mesh->normal = (vec3f*)(binBasePtr+ofs);
+          } else if (childType == "texcoord") {
+            size_t ofs = -1, num = -1;
+            // scan parameters ...
+            for (size_t pID = 0; pID < child->prop.size(); pID++) {
+              xml::ArenaProp *prop = child->prop[pID];
+              if (prop->name == "ofs") {
+                ofs = atol(prop->value.c_str());
+              }       
+              else if (prop->name == "num") {
+                num = atol(prop->value.c_str());
+              }       
+            }
+            assert(ofs != size_t(-1));
+            assert(num != size_t(-1));
+            mesh->numTexCoords = num;
+            mesh->texCoord = (vec2f*)(binBasePtr+ofs);
+          } else if (childType == "prim") {
+            size_t ofs = -1, num = -1;
+            // scan parameters ...
+            for (size_t pID = 0; pID < child->prop.size(); pID++) {
+              xml::ArenaProp *prop = child->prop[pID];
+              if (prop->name == "ofs") {
+                ofs = atol(prop->value.c_str());
+              }       
+              else if (prop->name == "num") {
+                num = atol(prop->value.c_str());
+              }       
             }
-            free(value);
-            //xmlFree(value);
+            assert(ofs != size_t(-1));
+            assert(num != size_t(-1));
+            mesh->numTriangles = num;
+            mesh->triangle = (vec4i*)(binBasePtr+ofs);
+          } else if (childType == "materiallist") {
+            for (int matID : numbersIn<int>(child->content)) {
+              Ref<RIVLMaterial> mat = nodeList[matID].cast<miniSG::RIVLMaterial>();
+              mat.ptr->refInc();
+              assert(mat.ptr);
+              mesh->material.push_back(mat);
+            }
+          } else {
+            throw std::runtime_error("unknown child node type '"+childType+"' for mesh node");
           }
-          lastNode = group.ptr;
-        } else {
-          nodeList.push_back(nullptr);
-          //throw std::runtime_error("unknown node type '"+nodeName+"' in RIVL model");
         }
+        // std::cout << "Found mesh " << mesh->toString() << std::endl;
+        lastNode = mesh.ptr;
+        // -------------------------------------------------------
+      } else if (nodeName == "Group") {
+        // -------------------------------------------------------
+        Ref<miniSG::Group> group = new miniSG::Group;
+        nodeList.push_back(group.ptr);
+        // xmlChar* value = xmlNodeListGetString(node->doc, node->children, 1);
+        if (node->content == "")
+          // empty group...
+          ;
+        // std::cout << "warning: xmlNodeListGetString(...) returned nullptr" << std::endl;
+        else {
+          const std::vector<int> childIDs = numbersIn<int>(node->content);
+          group->child.reserve(childIDs.size());
+          for (int childID : childIDs) {
+            miniSG::Node *child = nodeList[childID].ptr;
+            //assert(child);
+            group->child.push_back(child);
+          }
+        }
+        lastNode = group.ptr;
+      } else {
+        nodeList.push_back(nullptr);
+        //throw std::runtime_error("unknown node type '"+nodeName+"' in RIVL model");
       }
-      return lastNode;
+
+    }
+
+    Ref<Mesh> convertMesh(RIVLImport &import, TriangleMesh *tm);
+
+    /*! hand all meshes parsed since the last call to a background
+        conversion */
+    void startEarlyConversion(RIVLImport &import)
+    {
+      if (import.unconverted.empty())
+        return;
+
+      import.earlyConversions.emplace_back();
+      EarlyConversion &batch = import.earlyConversions.back();
+      batch.mesh.swap(import.unconverted);
+      batch.converted.resize(batch.mesh.size());
+      batch.done = std::async(std::launch::async, [&import, &batch]() {
+        parallel_for(int(batch.mesh.size()), [&](int i) {
+          batch.converted[i] = convertMesh(import, batch.mesh[i]);
+        });
+      });
     }
 
-    Ref<miniSG::Node> importRIVL(const std::string &fileName)
+    /*! streams a RIVL file, and parses each child of its root node as
+        soon as it has been read */
+    class RIVLReader : public xml::SubtreeReader
+    {
+    public:
+      RIVLReader(RIVLImport &import) : import(import) {}
+
+    protected:
+      void enclosingElement(const xml::StringRef &name,
+                            const std::vector<xml::ArenaProp> &) override
+      {
+        if (name != "BGFscene")
+          throw std::runtime_error("could not parse RIVL file: Not in RIVL format!?");
+      }
+
+      void subtree(xml::ArenaNode *node) override
+      {
+        parseBGFnode(import, node);
+
+        if (import.convertEarly && node->name == "Mesh") {
+          import.unconverted.push_back((TriangleMesh *)import.nodeList.back().ptr);
+          if (import.unconverted.size() >= 256)
+            startEarlyConversion(import);
+        }
+      }
+
+      size_t read(FILE *file, char *buffer, size_t size) override
+      {
+        IOSlots::Slot slot(import.ioSlots);
+        return fread(buffer, 1, size, file);
+      }
+
+    private:
+      RIVLImport &import;
+    };
+
+    Ref<miniSG::Node> importRIVL(RIVLImport &import,
+                                 const std::string &fileName)
     {
       string xmlFileName = fileName;
       string binFileName = fileName+".bin";
 
-      FILE *file = fopen(binFileName.c_str(),"rb");
-      if (!file)
-        perror("could not open binary file");
-      fseek(file,0,SEEK_END);
-      ssize_t fileSize =
-#ifdef _WIN32
-        _ftelli64(file);
-#else
-        ftell(file);
-#endif
-      fclose(file);
-      
-#ifdef _WIN32
-      HANDLE fileHandle = CreateFile(binFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-      if (fileHandle == nullptr)
-        fprintf(stderr, "could not open file '%s' (error %lu)\n", binFileName.c_str(), GetLastError());
-      HANDLE fileMappingHandle = CreateFileMapping(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
-      if (fileMappingHandle == nullptr)
-        fprintf(stderr, "could not create file mapping (error %lu)\n", GetLastError());
-#else
-      int fd = ::open(binFileName.c_str(), O_LARGEFILE | O_RDONLY);
-      if (fd == -1)
-        perror("could not open file");
-#endif
-
-      binBasePtr = (unsigned char *)
-#ifdef _WIN32
-        MapViewOfFile(fileMappingHandle, FILE_MAP_READ, 0, 0, fileSize);
-#else
-        mmap(nullptr,fileSize,PROT_READ,MAP_SHARED,fd,0);
-#endif
-
-      xml::XMLDoc *doc = xml::readXML(fileName);
-      if (doc->child.size() != 1 || doc->child[0]->name != "BGFscene") 
-        throw std::runtime_error("could not parse RIVL file: Not in RIVL format!?");
-      xml::Node *root_element = doc->child[0];
-      Ref<Node> node = parseBGFscene(root_element);
-      return node;
+      // with a region of interest, only the parts of the binary file
+      // that are needed get read, so it doesn't get read in up front
+      import.binFile = new MappedFile(binFileName, import.convertEarly ?
+                                      import.ioSlots : nullptr);
+      import.binBasePtr = (unsigned char *)import.binFile->data;
+
+      // each node gets parsed as soon as it has been read, so the xml
+      // file never is in memory as a whole
+      RIVLReader reader(import);
+      xml::parseXMLStream(fileName, reader);
+      if (import.nodeList.empty())
+        throw std::runtime_error("emply RIVL model !?");
+
+      startEarlyConversion(import);
+      return import.lastNode;
     }
 
-    void traverseSG(Model &model, Ref<miniSG::Node> &node, const affine3f &xfm=ospcommon::one)
+    /*! what a walk over the RIVL scene graph found: every mesh once,
+        in the order it was first reached, plus all its instances */
+    struct RIVLInstances {
+      std::map<TriangleMesh *, int> meshIDs;
+      std::vector<TriangleMesh *>   mesh;
+      std::vector<Instance>         instance;
+      std::vector<Ref<Camera> >     camera;
+    };
+
+    void traverseSG(RIVLInstances &found, miniSG::Node *node,
+                    const affine3f &xfm=ospcommon::one)
     {
-      Group *g = dynamic_cast<Group *>(node.ptr);
-      if (g) {
+      if (!node) return;
+
+      switch (node->kind) {
+      case Node::GROUP: {
+        Group *g = static_cast<Group *>(node);
         for (size_t i = 0; i < g->child.size(); i++)
-          traverseSG(model,g->child[i],xfm);
+          traverseSG(found,g->child[i].ptr,xfm);
         return;
       }
-
-      Transform *xf = dynamic_cast<Transform *>(node.ptr);
-      if (xf) {
-        traverseSG(model,xf->child,xfm*xf->xfm);
+      case Node::TRANSFORM: {
+        Transform *xf = static_cast<Transform *>(node);
+        traverseSG(found,xf->child.ptr,xfm*xf->xfm);
         return;
       }
-
-      RIVLCamera *cam = dynamic_cast<RIVLCamera *>(node.ptr);
-      if (cam) {
+      case Node::CAMERA: {
+        RIVLCamera *cam = static_cast<RIVLCamera *>(node);
         Ref<miniSG::Camera> c = new miniSG::Camera;
         c->from = cam->from;
         c->up = cam->up;
         c->at = cam->at;
-        model.camera.push_back(c);
+        found.camera.push_back(c);
         return;
       }
-
-      TriangleMesh *tm = dynamic_cast<TriangleMesh *>(node.ptr);
-      if (tm) {
-        static std::map<TriangleMesh *, int> meshIDs;
-        if (meshIDs.find(tm) == meshIDs.end()) {
-          meshIDs[tm] = model.mesh.size();
-          Mesh *mesh = new Mesh;
-          mesh->position.resize(tm->numVertices);
-          mesh->triangle.resize(tm->numTriangles);
-          mesh->triangleMaterialId.resize(tm->numTriangles);
-          bool anyNotZero = false;
-          for (size_t i = 0; i < tm->numTriangles; i++) {
-            Triangle t;
-            t.v0 = tm->triangle[i].x;
-            t.v1 = tm->triangle[i].y;
-            t.v2 = tm->triangle[i].z;
-
-            mesh->triangle[i] = t;
-
-            assert(mesh->triangle[i].v0 >= 0
-                   && mesh->triangle[i].v0 < mesh->position.size());
-            assert(mesh->triangle[i].v1 >= 0
-                   && mesh->triangle[i].v1 < mesh->position.size());
-            assert(mesh->triangle[i].v2 >= 0
-                   && mesh->triangle[i].v2 < mesh->position.size());
-
-            mesh->triangleMaterialId[i] = tm->triangle[i].w >>16;
-            if (mesh->triangleMaterialId[i]) anyNotZero = true;
-          }
-          if (!anyNotZero)
-            mesh->triangleMaterialId.clear();
-
-          for (size_t i = 0; i < tm->numVertices; i++) {
-            mesh->position[i].x = tm->vertex[i].x;
-            mesh->position[i].y = tm->vertex[i].y;
-            mesh->position[i].z = tm->vertex[i].z;
-            mesh->position[i].w = 0;
-          }
-          if (tm->numNormals > 0) {
-            mesh->normal.resize(tm->numVertices);
-            for (size_t i = 0; i < tm->numNormals; i++) {
-              mesh->normal[i].x = tm->normal[i].x;
-              mesh->normal[i].y = tm->normal[i].y;
-              mesh->normal[i].z = tm->normal[i].z;
-              mesh->normal[i].w = 0;
-            }
-          }
-          if (tm->numTexCoords > 0) {
-            mesh->texcoord.resize(tm->numVertices);
-            for (size_t i = 0; i < tm->numTexCoords; i++) {
-              (vec2f&)mesh->texcoord[i] = (vec2f&)tm->texCoord[i];
-            }
-          }
-          model.mesh.push_back(mesh);
-
-          if (tm->material.size() == 1) {
-            mesh->material = tm->material[0].ptr->general;
-          } else {
-            for (size_t i = 0; i < tm->material.size(); i++) {
-              mesh->materialList.push_back(tm->material[i].ptr->general);
-            }
-          }
-        }
-
-        int meshID = meshIDs[tm];
-        model.instance.push_back(Instance(meshID,xfm));
-        
+      case Node::TRIANGLE_MESH: {
+        TriangleMesh *tm = static_cast<TriangleMesh *>(node);
+        auto it = found.meshIDs.find(tm);
+        int meshID;
+        if (it == found.meshIDs.end()) {
+          meshID = found.mesh.size();
+          found.meshIDs[tm] = meshID;
+          found.mesh.push_back(tm);
+        } else
+          meshID = it->second;
+        found.instance.push_back(Instance(meshID,xfm));
         return;
       }
+      default:
+        break;
+      }
 
-      RIVLMaterial *mt = dynamic_cast<RIVLMaterial *>(node.ptr);
+      RIVLMaterial *mt = dynamic_cast<RIVLMaterial *>(node);
       if (mt) {
         return;
       }
@@ -725,14 +726,167 @@ namespace ospray {
                                + node->toString() + "' in traverseSG");
     }
 
+    /*! drop the instances that don't overlap 'region', and the meshes
+        that no instance uses anymore */
+    void cropToRegion(RIVLInstances &found, const box3f &region)
+    {
+      std::vector<box3f> meshBounds(found.mesh.size());
+      parallel_for(int(found.mesh.size()), [&](int meshID) {
+        const TriangleMesh *tm = found.mesh[meshID];
+        box3f bounds = ospcommon::empty;
+        for (size_t i = 0; i < tm->numVertices; i++)
+          bounds.extend(tm->vertex[i]);
+        meshBounds[meshID] = bounds;
+      });
+
+      RIVLInstances kept;
+      for (size_t i = 0; i < found.instance.size(); i++) {
+        const Instance &inst = found.instance[i];
+        if (!overlaps(xfmBounds(inst.xfm, meshBounds[inst.meshID]), region))
+          continue;
+        TriangleMesh *tm = found.mesh[inst.meshID];
+        auto it = kept.meshIDs.find(tm);
+        int meshID;
+        if (it == kept.meshIDs.end()) {
+          meshID = kept.mesh.size();
+          kept.meshIDs[tm] = meshID;
+          kept.mesh.push_back(tm);
+        } else
+          meshID = it->second;
+        kept.instance.push_back(Instance(meshID,inst.xfm));
+      }
+
+      cout << "#osp:minisg: region of interest keeps " << kept.instance.size()
+           << " of " << found.instance.size() << " RIVL instances" << endl;
+
+      found.meshIDs.swap(kept.meshIDs);
+      found.mesh.swap(kept.mesh);
+      found.instance.swap(kept.instance);
+    }
+
+    /*! convert a RIVL mesh into a miniSG mesh */
+    Ref<Mesh> convertMesh(RIVLImport &import, TriangleMesh *tm)
+    {
+      Mesh *mesh = new Mesh;
+
+      bool anyNotZero = false;
+      for (size_t i = 0; i < tm->numTriangles && !anyNotZero; i++)
+        anyNotZero = (tm->triangle[i].w >> 16) != 0;
+      if (anyNotZero) {
+        mesh->triangleMaterialId.resize(tm->numTriangles);
+        for (size_t i = 0; i < tm->numTriangles; i++)
+          mesh->triangleMaterialId[i] = tm->triangle[i].w >> 16;
+      }
+
+      for (size_t i = 0; i < tm->numTriangles; i++) {
+        assert(size_t(tm->triangle[i].x) < tm->numVertices);
+        assert(size_t(tm->triangle[i].y) < tm->numVertices);
+        assert(size_t(tm->triangle[i].z) < tm->numVertices);
+      }
+
+      const bool layoutMatches =
+        (tm->numNormals == 0 || tm->numNormals == tm->numVertices) &&
+        (tm->numTexCoords == 0 || tm->numTexCoords == tm->numVertices);
+
+      if (layoutMatches) {
+        // vertices and indices stay in the mapped file, and get
+        // handed to ospray as shared buffers
+        mesh->shared.owner        = import.binFile.ptr;
+        mesh->shared.position     = tm->vertex;
+        mesh->shared.normal       = tm->numNormals ? tm->normal : nullptr;
+        mesh->shared.texcoord     = tm->numTexCoords ? tm->texCoord : nullptr;
+        mesh->shared.index        = (const int32_t *)tm->triangle;
+        mesh->shared.indexStride  = 4;
+        mesh->shared.numVertices  = tm->numVertices;
+        mesh->shared.numTriangles = tm->numTriangles;
+        padSharedPositions(*mesh, *import.binFile);
+      } else {
+        mesh->position.resize(tm->numVertices);
+        mesh->triangle.resize(tm->numTriangles);
+        for (size_t i = 0; i < tm->numTriangles; i++) {
+          Triangle t;
+          t.v0 = tm->triangle[i].x;
+          t.v1 = tm->triangle[i].y;
+          t.v2 = tm->triangle[i].z;
+          mesh->triangle[i] = t;
+        }
+
+        for (size_t i = 0; i < tm->numVertices; i++) {
+          mesh->position[i].x = tm->vertex[i].x;
+          mesh->position[i].y = tm->vertex[i].y;
+          mesh->position[i].z = tm->vertex[i].z;
+          mesh->position[i].w = 0;
+        }
+        if (tm->numNormals > 0) {
+          mesh->normal.resize(tm->numVertices);
+          for (size_t i = 0; i < tm->numNormals; i++) {
+            mesh->normal[i].x = tm->normal[i].x;
+            mesh->normal[i].y = tm->normal[i].y;
+            mesh->normal[i].z = tm->normal[i].z;
+            mesh->normal[i].w = 0;
+          }
+        }
+        if (tm->numTexCoords > 0) {
+          mesh->texcoord.resize(tm->numVertices);
+          for (size_t i = 0; i < tm->numTexCoords; i++) {
+            (vec2f&)mesh->texcoord[i] = (vec2f&)tm->texCoord[i];
+          }
+        }
+      }
+
+      if (tm->material.size() == 1) {
+        mesh->material = tm->material[0].ptr->general;
+      } else {
+        for (size_t i = 0; i < tm->material.size(); i++) {
+          mesh->materialList.push_back(tm->material[i].ptr->general);
+        }
+      }
+      return mesh;
+    }
+
     /*! import a wavefront OBJ file, and add it to the specified model */
     void importRIVL(Model &model, const ospcommon::FileName &fileName)
     {
-      nodeList.clear();
-      Ref<miniSG::Node> sg = importRIVL(fileName);
-      traverseSG(model,sg);
-      nodeList.clear();
-      sg = 0;
+      RIVLImport import;
+      // without a region of interest all meshes get used, so they can
+      // get converted while the file is still being read
+      import.convertEarly = model.regionOfInterest.empty();
+      import.ioSlots = model.ioSlots;
+      Ref<miniSG::Node> sg = importRIVL(import, fileName);
+
+      std::map<TriangleMesh *, Ref<Mesh> > converted;
+      for (EarlyConversion &batch : import.earlyConversions) {
+        batch.done.get();
+        for (size_t i = 0; i < batch.mesh.size(); i++)
+          converted[batch.mesh[i]] = batch.converted[i];
+      }
+
+      // find unique meshes and their instances ...
+      RIVLInstances found;
+      traverseSG(found,sg.ptr);
+
+      // ... drop the ones outside the region of interest, which only
+      // needs the vertices of the mapped file to be read ...
+      if (!model.regionOfInterest.empty())
+        cropToRegion(found, model.regionOfInterest);
+
+      // ... convert the meshes that weren't yet, in parallel ...
+      const size_t firstMeshID = model.mesh.size();
+      model.mesh.resize(firstMeshID + found.mesh.size());
+      parallel_for(int(found.mesh.size()), [&](int i) {
+        auto it = converted.find(found.mesh[i]);
+        model.mesh[firstMeshID + i] = it != converted.end()
+          ? it->second : convertMesh(import, found.mesh[i]);
+      });
+
+      // ... and add the instances, relative to the meshes we just added
+      for (size_t i = 0; i < found.instance.size(); i++) {
+        Instance inst = found.instance[i];
+        inst.meshID += firstMeshID;
+        model.instance.push_back(inst);
+      }
+      model.camera.insert(model.camera.end(),
+                          found.camera.begin(), found.camera.end());
     }
     
   } // ::ospray::minisg
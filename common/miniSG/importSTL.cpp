@@ -16,77 +16,306 @@
 
 #include "miniSG.h"
 #include "importer.h"
+// ospcommon
+#include "ospcommon/tasking/parallel_for.h"
+// stl
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
 
 namespace ospray {
   namespace miniSG {
     using std::cout;
     using std::endl;
 
-    struct STLTriangle {
-      vec3f normal;
-      vec3f v0, v1, v2;
-      uint16_t attribute;
+    /*! size of a binary STL triangle record: normal, three vertices,
+        and a 16-bit attribute */
+    static const size_t STL_RECORD_SIZE = 50;
+    static const size_t STL_HEADER_SIZE = 84;
+
+    /*! decode the vertices of all triangle records of a binary STL
+        file, in parallel blocks */
+    static void decodeBinarySTL(const unsigned char *records,
+                                size_t numTriangles,
+                                std::vector<vec3f> &corner)
+    {
+      corner.resize(3*numTriangles);
+      const size_t numBlocks = numBlocksFor(numTriangles, 1<<16);
+      parallel_for(int(numBlocks), [&](int blockID) {
+        const size_t begin = numTriangles * blockID / numBlocks;
+        const size_t end   = numTriangles * (blockID+1) / numBlocks;
+        for (size_t i = begin; i < end; i++) {
+          // skip the normal; records are not 4-byte aligned, so memcpy
+          const unsigned char *rec = records + i*STL_RECORD_SIZE;
+          memcpy(&corner[3*i], rec + sizeof(vec3f), 3*sizeof(vec3f));
+        }
+      });
+    }
+
+    /*! parse all 'vertex x y z' lines in [begin,end) */
+    static void parseASCIIVertices(const char *begin, const char *end,
+                                   std::vector<vec3f> &corner)
+    {
+      const char *s = begin;
+      while (s < end) {
+        const char *eol = (const char *)memchr(s, '\n', end-s);
+        if (!eol) eol = end;
+
+        while (s < eol && (*s == ' ' || *s == '\t')) s++;
+        if (eol-s > 6 && !strncmp(s, "vertex", 6)) {
+          // copy into a terminated buffer; the mapped file is not
+          char line[256];
+          const size_t len = std::min(size_t(eol-s-6), sizeof(line)-1);
+          memcpy(line, s+6, len);
+          line[len] = 0;
+
+          vec3f v;
+          char *p = line;
+          v.x = strtof(p, &p);
+          v.y = strtof(p, &p);
+          v.z = strtof(p, &p);
+          corner.push_back(v);
+        }
+        s = eol+1;
+      }
+    }
+
+    /*! parse an ASCII STL file; the file gets split into blocks at line
+        boundaries, and the blocks get parsed in parallel */
+    static void parseASCIISTL(const char *text, size_t size,
+                              std::vector<vec3f> &corner)
+    {
+      const size_t numBlocks = numBlocksFor(size, 1<<22);
+      std::vector<const char *> blockBegin(numBlocks+1);
+      blockBegin[0] = text;
+      blockBegin[numBlocks] = text + size;
+      for (size_t i = 1; i < numBlocks; i++) {
+        const char *s = std::max(text + size*i/numBlocks, blockBegin[i-1]);
+        const char *eol = (const char *)memchr(s, '\n', text+size-s);
+        blockBegin[i] = eol ? eol+1 : text+size;
+      }
+
+      std::vector<std::vector<vec3f> > blockCorner(numBlocks);
+      parallel_for(int(numBlocks), [&](int blockID) {
+        parseASCIIVertices(blockBegin[blockID], blockBegin[blockID+1],
+                           blockCorner[blockID]);
+      });
+
+      size_t numCorners = 0;
+      for (size_t i = 0; i < numBlocks; i++)
+        numCorners += blockCorner[i].size();
+      corner.reserve(numCorners);
+      for (size_t i = 0; i < numBlocks; i++)
+        corner.insert(corner.end(),
+                      blockCorner[i].begin(), blockCorner[i].end());
+
+      if (corner.size() % 3)
+        error("ASCII STL file has facets that do not have three vertices");
+    }
+
+    /*! drop all triangles (three consecutive corners each) whose bounds
+        don't overlap 'region', keeping the others in order */
+    static void cropTriangles(std::vector<vec3f> &corner, const box3f &region)
+    {
+      const size_t numTriangles = corner.size()/3;
+      size_t numKept = 0;
+      for (size_t i = 0; i < numTriangles; i++) {
+        box3f bounds = ospcommon::empty;
+        bounds.extend(corner[3*i+0]);
+        bounds.extend(corner[3*i+1]);
+        bounds.extend(corner[3*i+2]);
+        if (!overlaps(bounds, region)) continue;
+        if (numKept != i) {
+          corner[3*numKept+0] = corner[3*i+0];
+          corner[3*numKept+1] = corner[3*i+1];
+          corner[3*numKept+2] = corner[3*i+2];
+        }
+        numKept++;
+      }
+      corner.resize(3*numKept);
+    }
+
+    struct PositionHash {
+      size_t operator()(const vec3f &v) const
+      {
+        uint32_t bits[3];
+        memcpy(bits, &v, sizeof(bits));
+        uint64_t h = bits[0];
+        h = h * 0x9e3779b97f4a7c15ull + bits[1];
+        h = h * 0x9e3779b97f4a7c15ull + bits[2];
+        return h ^ (h >> 29);
+      }
     };
 
-    /*! import a list of STL files */
-    void importSTL(std::vector<Model *> &animation, const ospcommon::FileName &fileName)
+    struct PositionEqual {
+      bool operator()(const vec3f &a, const vec3f &b) const
+      { return a.x == b.x && a.y == b.y && a.z == b.z; }
+    };
+
+    /*! merge corners with identical positions into shared vertices.
+        vertex IDs get assigned in order of first use, exactly like
+        ImportHelper::addVertex() would do */
+    static void weldVertices(std::vector<vec3f> &corner, Mesh &mesh)
+    {
+      const size_t numCorners = corner.size();
+
+      // normalize -0 to +0, so both hash (and weld) the same
+      std::vector<uint32_t> hash(numCorners);
+      parallel_for(int(numCorners/3), [&](int i) {
+        for (int j = 0; j < 3; j++) {
+          vec3f &v = corner[3*i+j];
+          v = v + vec3f(0.f);
+          hash[3*i+j] = uint32_t(PositionHash()(v) >> 32);
+        }
+      });
+
+      // ------------------------------------------------------------------
+      // sort corner IDs into buckets by hash, keeping them in corner
+      // order within each bucket (per-block counting sort)
+      // ------------------------------------------------------------------
+      const int bucketBits = 8;
+      const size_t numBuckets = 1<<bucketBits;
+      const size_t numBlocks = numBlocksFor(numCorners, 1<<16);
+      std::vector<size_t> count(numBlocks*numBuckets, 0);
+
+      parallel_for(int(numBlocks), [&](int blockID) {
+        const size_t begin = numCorners * blockID / numBlocks;
+        const size_t end   = numCorners * (blockID+1) / numBlocks;
+        size_t *blockCount = &count[blockID*numBuckets];
+        for (size_t i = begin; i < end; i++)
+          blockCount[hash[i] >> (32-bucketBits)]++;
+      });
+
+      std::vector<size_t> bucketBegin(numBuckets+1);
+      std::vector<size_t> offset(numBlocks*numBuckets);
+      size_t sum = 0;
+      for (size_t b = 0; b < numBuckets; b++) {
+        bucketBegin[b] = sum;
+        for (size_t blockID = 0; blockID < numBlocks; blockID++) {
+          offset[blockID*numBuckets+b] = sum;
+          sum += count[blockID*numBuckets+b];
+        }
+      }
+      bucketBegin[numBuckets] = sum;
+
+      std::vector<uint32_t> sorted(numCorners);
+      parallel_for(int(numBlocks), [&](int blockID) {
+        const size_t begin = numCorners * blockID / numBlocks;
+        const size_t end   = numCorners * (blockID+1) / numBlocks;
+        size_t *blockOffset = &offset[blockID*numBuckets];
+        for (size_t i = begin; i < end; i++)
+          sorted[blockOffset[hash[i] >> (32-bucketBits)]++] = i;
+      });
+
+      // ------------------------------------------------------------------
+      // per bucket, find the first corner with the same position
+      // ------------------------------------------------------------------
+      std::vector<uint32_t> first(numCorners);
+      parallel_for(int(numBuckets), [&](int b) {
+        std::unordered_map<vec3f, uint32_t, PositionHash, PositionEqual> known;
+        known.reserve(bucketBegin[b+1] - bucketBegin[b]);
+        for (size_t i = bucketBegin[b]; i < bucketBegin[b+1]; i++) {
+          const uint32_t c = sorted[i];
+          first[c] = known.insert(std::make_pair(corner[c], c)).first->second;
+        }
+      });
+
+      // ------------------------------------------------------------------
+      // number vertices in order of first use
+      // ------------------------------------------------------------------
+      std::vector<uint32_t> vertexID(numCorners);
+      mesh.position.clear();
+      for (size_t c = 0; c < numCorners; c++) {
+        if (first[c] == c) {
+          vertexID[c] = mesh.position.size();
+          mesh.position.push_back(vec3fa(corner[c]));
+        } else
+          vertexID[c] = vertexID[first[c]];
+      }
+
+      mesh.triangle.resize(numCorners/3);
+      parallel_for(int(numCorners/3), [&](int i) {
+        Triangle &t = mesh.triangle[i];
+        t.v0 = vertexID[3*i+0];
+        t.v1 = vertexID[3*i+1];
+        t.v2 = vertexID[3*i+2];
+      });
+    }
+
+    std::vector<std::string> listSTLAnimation(const ospcommon::FileName &fileName)
     {
       FILE *file = fopen(fileName.c_str(),"rb");
       if (!file) error("could not open input file");
+      std::vector<std::string> timeSteps;
       char line[10000];
       while (fgets(line,10000,file) && !feof(file)) {
         char *eol = strstr(line,"\n");
         if (eol) *eol = 0;
+        if (line[0]) timeSteps.push_back(line);
+      }
+      fclose(file);
+      return timeSteps;
+    }
+
+    /*! import a list of STL files */
+    void importSTL(std::vector<Model *> &animation, const ospcommon::FileName &fileName)
+    {
+      const std::vector<std::string> timeSteps = listSTLAnimation(fileName);
+      for (size_t i = 0; i < timeSteps.size(); i++) {
         Model *model = new Model;
         animation.push_back(model);
-        importSTL(*model,line);
+        importSTL(*model,timeSteps[i]);
       }
       cout << "done importing STL animation; found " 
            << animation.size() << " time steps" << endl;
-      fclose(file);
     }
 
     void importSTL(Model &model,
                    const ospcommon::FileName &fileName)
     {
-      FILE *file = fopen(fileName.c_str(),"rb");
-      if (!file) error("could not open input file");
-      char header[80];
-      int32_t rc = fread(header,1,80,file);
-      if (rc < 80)
-        error("could not read header");
-      int32_t numTriangles;
-      rc = fread(&numTriangles,sizeof(int),1,file);
-      Assert(rc == 1 && "could not read num triangles from STL file");
-      cout << "miniSG::importSTL: #tris="
-           << numTriangles << " (" << fileName.c_str() << ")" << endl;
-
-      ImportHelper importer(model,fileName.c_str());
-
-      miniSG::Triangle triangle;
-      STLTriangle stlTri;
-      for (int32_t i=0 ; i < numTriangles ; i++) {
-        rc = fread(&stlTri.normal,sizeof(stlTri.normal),1,file);
-        Assert(rc == 1 && "partial or broken STL file!?");
-        rc = fread(&stlTri.v0,sizeof(stlTri.v0),1,file);
-        Assert(rc == 1 && "partial or broken STL file!?");
-        rc = fread(&stlTri.v1,sizeof(stlTri.v1),1,file);
-        Assert(rc == 1 && "partial or broken STL file!?");
-        rc = fread(&stlTri.v2,sizeof(stlTri.v2),1,file);
-        Assert(rc == 1 && "partial or broken STL file!?");
-        rc = fread(&stlTri.attribute,sizeof(unsigned short),1,file);
-        Assert(rc == 1 && "partial or broken STL file!?");
-        
-        triangle.v0 = importer.addVertex(stlTri.v0);
-        triangle.v1 = importer.addVertex(stlTri.v1);
-        triangle.v2 = importer.addVertex(stlTri.v2);
-        // triangle.materialID = -1;
-        importer.addTriangle(triangle);
+      Ref<MappedFile> file = new MappedFile(fileName.str(), model.ioSlots);
+      const unsigned char *data = file->data;
+      const size_t size = file->size;
+
+      // binary files may start with 'solid' too; only treat the file as
+      // ascii if its size doesn't match the binary triangle count
+      bool binary = true;
+      uint32_t numTriangles = 0;
+      if (size >= STL_HEADER_SIZE) {
+        memcpy(&numTriangles, data+80, sizeof(numTriangles));
+        binary = (STL_HEADER_SIZE + size_t(numTriangles)*STL_RECORD_SIZE
+                  <= size);
+      } else
+        binary = false;
+      if (size >= 5 && !strncmp((const char *)data, "solid", 5) &&
+          STL_HEADER_SIZE + size_t(numTriangles)*STL_RECORD_SIZE != size)
+        binary = false;
+
+      std::vector<vec3f> corner;
+      if (binary)
+        decodeBinarySTL(data + STL_HEADER_SIZE, numTriangles, corner);
+      else {
+        if (size < 5 || strncmp((const char *)data, "solid", 5))
+          error("'"+fileName.str()+"' is neither a binary nor an ascii STL file");
+        parseASCIISTL((const char *)data, size, corner);
       }
-      importer.finalize();
+      file = nullptr;
+
+      // cull before welding, which is where most of the time goes
+      if (!model.regionOfInterest.empty())
+        cropTriangles(corner, model.regionOfInterest);
+
+      cout << "miniSG::importSTL: #tris="
+           << corner.size()/3 << " (" << fileName.c_str() << ")" << endl;
+      if (corner.empty()) return;
+
+      Ref<Mesh> mesh = new Mesh;
+      weldVertices(corner, *mesh);
+
+      const int meshID = model.mesh.size();
+      model.mesh.push_back(mesh);
+      model.instance.push_back(Instance(meshID));
     }
 
   } // ::ospray::minisg
 } // ::ospray
-
-
@@ -16,39 +16,70 @@
 
 #include "miniSG.h"
 #include "importer.h"
+// ospcommon
+#include "ospcommon/tasking/parallel_for.h"
+// stl
+#include <cstring>
 
 namespace ospray {
   namespace miniSG {
     using std::cout;
     using std::endl;
 
+    /*! import a TRI file (an int32 vertex count, followed by that many
+        vec3fa positions and as many vec3fa normals; every three
+        consecutive vertices form a triangle). the file gets mapped and
+        copied into the mesh in large parallel blocks */
     void importTRI(Model &model,
                    const ospcommon::FileName &fileName)
     {
-      FILE *file = fopen(fileName.c_str(),"rb");
-      if (!file) error("could not open input file");
+      Ref<MappedFile> file = new MappedFile(fileName.str(), model.ioSlots);
 
-      int32_t numVertices;
-      auto rc = fread(&numVertices,1,sizeof(numVertices),file);
+      int32_t numVertices = 0;
+      if (file->size >= sizeof(numVertices))
+        memcpy(&numVertices, file->data, sizeof(numVertices));
+      if (numVertices < 0 ||
+          file->size < sizeof(numVertices) + 2*size_t(numVertices)*sizeof(vec3fa))
+        error("TRI file '"+fileName.str()+"' is truncated");
 
-      Mesh *mesh = new Mesh;
-      model.mesh.push_back(mesh);
+      const unsigned char *positions = file->data + sizeof(numVertices);
+      const unsigned char *normals   = positions + numVertices*sizeof(vec3fa);
+      const size_t numTriangles = numVertices/3;
 
+      Mesh *mesh = new Mesh;
       mesh->position.resize(numVertices);
       mesh->normal.resize(numVertices);
-      mesh->triangle.resize(numVertices/3);
-      rc = fread(&mesh->position[0],numVertices,4*sizeof(float),file);
-      rc = fread(&mesh->normal[0],numVertices,4*sizeof(float),file);
-      (void)rc;
-      for (int i=0;i<numVertices/3;i++) {
-        mesh->triangle[i].v0 = 3*i+0;
-        mesh->triangle[i].v1 = 3*i+1;
-        mesh->triangle[i].v2 = 3*i+2;
+      mesh->triangle.resize(numTriangles);
+
+      const size_t numBlocks = numBlocksFor(numTriangles, 1<<16);
+      parallel_for(int(numBlocks), [&](int blockID) {
+        const size_t begin = numTriangles * blockID / numBlocks;
+        const size_t end   = numTriangles * (blockID+1) / numBlocks;
+        if (begin == end) return;
+
+        const size_t offset = 3*begin*sizeof(vec3fa);
+        const size_t size   = 3*(end-begin)*sizeof(vec3fa);
+        memcpy(&mesh->position[3*begin], positions + offset, size);
+        memcpy(&mesh->normal[3*begin],   normals   + offset, size);
+
+        for (size_t i = begin; i < end; i++) {
+          mesh->triangle[i].v0 = 3*i+0;
+          mesh->triangle[i].v1 = 3*i+1;
+          mesh->triangle[i].v2 = 3*i+2;
+        }
+      });
+
+      // vertices past the last full triangle, if any
+      const size_t tail = 3*numTriangles;
+      if (tail < size_t(numVertices)) {
+        const size_t size = (numVertices-tail)*sizeof(vec3fa);
+        memcpy(&mesh->position[tail], positions + tail*sizeof(vec3fa), size);
+        memcpy(&mesh->normal[tail],   normals   + tail*sizeof(vec3fa), size);
       }
-      model.instance.push_back(Instance(0));
+
+      model.mesh.push_back(mesh);
+      model.instance.push_back(Instance(model.mesh.size()-1));
     }
 
   } // ::ospray::minisg
 } // ::ospray
-
-
@@ -20,9 +20,13 @@
 #include "miniSG.h"
 #include "importer.h"
 // xml lib
-#include "common/xml/XML.h"
+#include "common/xml/XMLArena.h"
+#include "common/xml/NumberParser.h"
+// ospcommon
+#include "ospcommon/tasking/parallel_for.h"
 // std
 #include <fstream>
+#include <mutex>
 #include <set>
 
 namespace ospray {
@@ -33,6 +37,9 @@ namespace ospray {
 
     void warnIgnore(const std::string &nodeType)
     {
+      // several files may get imported at the same time
+      static std::mutex mutex;
+      std::lock_guard<std::mutex> lock(mutex);
       static std::set<std::string> alreadyWarned;
       if (alreadyWarned.find(nodeType) != alreadyWarned.end()) return;
       alreadyWarned.insert(nodeType);
@@ -41,30 +48,39 @@ namespace ospray {
                 << std::endl;
       
     }
-    void parseVectorOfVec3fas(std::vector<vec3fa> &vec, const std::string &str)
-    {
-      char *s = strdup(str.c_str());
-      const char *delim = "\n\t\r, ";
-      char *tok = strtok(s,delim);
-      while (tok) {
-        vec3fa v;
-        v.x = atof(tok);
-
-        tok = strtok(NULL,delim);
-        if (!tok) break;
-        v.y = atof(tok);
-        
-        tok = strtok(NULL,delim);
-        if (!tok) break;
-        v.z = atof(tok);
+    /*! an IndexedFaceSet found while walking the scene, to be converted
+        into a mesh once all of them are known */
+    struct FaceSet {
+      FaceSet(const affine3f &xfm, xml::ArenaNode *node) : xfm(xfm), node(node) {}
+      affine3f   xfm;
+      xml::ArenaNode *node;
+    };
 
-        vec.push_back(v);
+    /*! parse all numbers in the given attribute value; long values
+        get parsed in parallel */
+    template<typename T>
+    void parseNumberList(std::vector<T> &values, const xml::StringRef &str)
+    {
+      const size_t numSkipped =
+        xml::parseNumberList(str.begin(), str.end(), values);
+      if (numSkipped)
+        cout << "#osp:minisg: X3D: skipped " << numSkipped
+             << " values that are not numbers" << endl;
+    }
 
-        tok = strtok(NULL,delim);
-      }
-      free(s);
+    void parseVectorOfVec3fas(std::vector<vec3fa> &vec, const xml::ArenaProp *prop)
+    {
+      if (!prop) return;
+      std::vector<float> coord;
+      parseNumberList(coord, prop->value);
+      const size_t num = coord.size()/3;
+      const size_t first = vec.size();
+      vec.resize(first+num);
+      for (size_t i = 0; i < num; i++)
+        vec[first+i] = vec3fa(coord[3*i+0], coord[3*i+1], coord[3*i+2]);
     }
-    void parseIndexedFaceSet(Model &model, const affine3f &xfm, xml::Node *root)
+
+    Ref<Mesh> parseIndexedFaceSet(xml::ArenaNode *root)
     {
       Ref<Mesh> mesh = new Mesh;
       mesh->material = new Material;
@@ -72,63 +88,71 @@ namespace ospray {
       // -------------------------------------------------------
       // parse coordinate indices
       // -------------------------------------------------------
-      std::string coordIndex = root->getProp("coordIndex");
-      assert(coordIndex != "");
-
-      char *s = strdup(coordIndex.c_str()); coordIndex = "";
-      const char *delim = "\n\t\r, ";
-      char *tok = strtok(s,delim);
-      std::vector<int> ID;
-      while (tok) {
-        long thisID = atol(tok);
-        if (thisID == -1) {
-          for (size_t i = 2; i < ID.size(); i++) {
-            Triangle t;
-            t.v0 = ID[0];
-            t.v1 = ID[i-1];
-            t.v2 = ID[i];
-            mesh->triangle.push_back(t);
-          }
-          ID.clear();
-        } else {
-          ID.push_back(thisID);
+      const xml::ArenaProp *coordIndex = root->findProp("coordIndex");
+      assert(coordIndex && coordIndex->value != "");
+
+      std::vector<int> index;
+      parseNumberList(index, coordIndex->value);
+
+      // faces are terminated by -1; fan-triangulate each of them
+      size_t faceBegin = 0;
+      for (size_t i = 0; i < index.size(); i++) {
+        if (index[i] != -1) continue;
+        for (size_t j = faceBegin+2; j < i; j++) {
+          Triangle t;
+          t.v0 = index[faceBegin];
+          t.v1 = index[j-1];
+          t.v2 = index[j];
+          mesh->triangle.push_back(t);
         }
-        tok = strtok(NULL,delim);
+        faceBegin = i+1;
       }
-      free(s);
 
       // -------------------------------------------------------
       // now, parse children for vertex arrays
       // -------------------------------------------------------
       for (size_t childID = 0; childID < root->child.size(); childID++) {
-        xml::Node *node = root->child[childID];
+        xml::ArenaNode *node = root->child[childID];
         
         if (node->name == "Coordinate") {
-          parseVectorOfVec3fas(mesh->position,node->getProp("point"));
+          parseVectorOfVec3fas(mesh->position,node->findProp("point"));
           continue;
         }
         if (node->name == "Normal") {
-          parseVectorOfVec3fas(mesh->normal,node->getProp("vector"));
+          parseVectorOfVec3fas(mesh->normal,node->findProp("vector"));
           continue;
         }
         if (node->name == "Color") {
           /* ignore for now */
-          parseVectorOfVec3fas(mesh->color,node->getProp("color"));
+          parseVectorOfVec3fas(mesh->color,node->findProp("color"));
           // warnIgnore("'Color' (in IndexedFaceSet)");
           continue;
         }
+      }
+
+      return mesh;
+    }
+
+    /*! check that we know how to parse the given face set, before
+        parsing it in parallel with the others */
+    void checkIndexedFaceSet(xml::ArenaNode *root)
+    {
+      for (size_t childID = 0; childID < root->child.size(); childID++) {
+        xml::ArenaNode *node = root->child[childID];
+        if (node->name == "Coordinate" ||
+            node->name == "Normal" ||
+            node->name == "Color")
+          continue;
 
         throw std::runtime_error("importX3D: unknown child type '"
-                                 + node->name + "' to 'IndexedFaceSet' node");
+                                 + node->name.str() + "' to 'IndexedFaceSet' node");
       }
-
-      model.mesh.push_back(mesh);
-      model.instance.push_back(Instance(model.mesh.size()-1,xfm));
     }
-    void parseShape(Model &model, const affine3f &xfm, xml::Node *root)
+
+    void parseShape(std::vector<FaceSet> &faceSets, const affine3f &xfm, xml::ArenaNode *root)
     {
       for (size_t childID = 0; childID < root->child.size(); childID++) {
-        xml::Node *node = root->child[childID];
+        xml::ArenaNode *node = root->child[childID];
         
         if (node->name == "Appearance") {
           /* ignore for now */
@@ -141,21 +165,21 @@ namespace ospray {
           continue;
         }
         if (node->name == "IndexedFaceSet") {
-          /* ignore for now */
-          parseIndexedFaceSet(model,xfm,node);
+          checkIndexedFaceSet(node);
+          faceSets.push_back(FaceSet(xfm,node));
           continue;
         }
 
-        throw std::runtime_error("importX3D: unknown child type '"+node->name+"' to 'Shape' node");
+        throw std::runtime_error("importX3D: unknown child type '"+node->name.str()+"' to 'Shape' node");
       }
     }
-    void parseTransform(Model &model, const affine3f &parentXFM, xml::Node *root)
+    void parseTransform(std::vector<FaceSet> &faceSets, const affine3f &parentXFM, xml::ArenaNode *root)
     {
       affine3f xfm = parentXFM;
 
       // TODO: parse actual xfm parmeters ...
       for (size_t childID = 0; childID < root->child.size(); childID++) {
-        xml::Node *node = root->child[childID];
+        xml::ArenaNode *node = root->child[childID];
         
         if (node->name == "DirectionalLight") {
           /* ignore */
@@ -163,26 +187,26 @@ namespace ospray {
           continue;
         }
         if (node->name == "Transform") {
-          parseTransform(model,xfm,node);
+          parseTransform(faceSets,xfm,node);
           continue;
         }
         if (node->name == "Shape") {
-          parseShape(model,xfm,node);
+          parseShape(faceSets,xfm,node);
           continue;
         }
 
         throw std::runtime_error("importX3D: unknown 'transform' child type '"
-                                 + node->name + "'");
+                                 + node->name.str() + "'");
       }
     }
-    void parseX3D(Model &model, xml::Node *root)
+    void parseX3D(std::vector<FaceSet> &faceSets, xml::ArenaNode *root)
     {
       assert(root->child.size() == 2);
       assert(root->child[0]->name == "head");
       assert(root->child[1]->name == "Scene");
-      xml::Node *sceneNode = root->child[1];
+      xml::ArenaNode *sceneNode = root->child[1];
       for (size_t childID = 0; childID < sceneNode->child.size(); childID++) {
-        xml::Node *node = sceneNode->child[childID];
+        xml::ArenaNode *node = sceneNode->child[childID];
         if (node->name == "Background") {
           /* ignore */
           warnIgnore("'Background' (in root node)");
@@ -205,11 +229,11 @@ namespace ospray {
         }
         if (node->name == "Transform") {
           affine3f xfm = ospcommon::one;
-          parseTransform(model,xfm,node);
+          parseTransform(faceSets,xfm,node);
           /* ignore */
           continue;
         }
-        throw std::runtime_error("importX3D: unknown node type '"+node->name+"'");
+        throw std::runtime_error("importX3D: unknown node type '"+node->name.str()+"'");
       }
     }
 
@@ -217,13 +241,35 @@ namespace ospray {
     void importX3D(Model &model, 
                    const ospcommon::FileName &fileName)
     {
-      xml::XMLDoc *doc = xml::readXML(fileName);
+      // the file gets parsed in place as it is read, so that is all
+      // subject to the I/O limit
+      xml::ArenaDoc *doc = nullptr;
+      {
+        IOSlots::Slot slot(model.ioSlots);
+        doc = xml::readXMLInSitu(fileName);
+      }
       assert(doc);
       PRINT(doc->child[0]->name);
       if (doc->child.size() != 1 || doc->child[0]->name != "X3D") 
         throw std::runtime_error("could not parse X3D file: Not in X3D format!?");
-      xml::Node *root_element = doc->child[0];
-      parseX3D(model,root_element);
+      xml::ArenaNode *root_element = doc->child[0];
+
+      // find all face sets first, then parse them in parallel; they are
+      // independent of each other
+      std::vector<FaceSet> faceSets;
+      parseX3D(faceSets,root_element);
+
+      std::vector<Ref<Mesh> > meshes(faceSets.size());
+      parallel_for(int(faceSets.size()), [&](int i) {
+        meshes[i] = parseIndexedFaceSet(faceSets[i].node);
+      });
+
+      for (size_t i = 0; i < meshes.size(); i++) {
+        model.mesh.push_back(meshes[i]);
+        model.instance.push_back(Instance(model.mesh.size()-1,
+                                          faceSets[i].xfm));
+      }
+      delete doc;
     }
 
   } // ::ospray::minisg
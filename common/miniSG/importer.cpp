@@ -14,7 +14,27 @@
 // limitations under the License.                                           //
 // ======================================================================== //
 
+// O_LARGEFILE is a GNU extension.
+#ifdef __APPLE__
+#define  O_LARGEFILE  0
+#endif
+
 #include "importer.h"
+// stdlib, for mmap
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+#include <fcntl.h>
+// stl
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <vector>
 
 namespace ospray {
   namespace miniSG {
@@ -59,5 +79,168 @@ namespace ospray {
       mesh->triangle.push_back(triangle);
     }
 
+    MappedFile::MappedFile(const std::string &fileName, IOSlots *ioSlots)
+      : data(nullptr), size(0)
+    {
+#ifdef _WIN32
+      fileHandle = CreateFile(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+      if (fileHandle == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("could not open file '"+fileName+"'");
+
+      LARGE_INTEGER fileSize;
+      GetFileSizeEx(fileHandle, &fileSize);
+      size = fileSize.QuadPart;
+
+      mappingHandle = CreateFileMapping(fileHandle, nullptr, PAGE_READONLY,
+                                        0, 0, nullptr);
+      if (mappingHandle == nullptr) {
+        CloseHandle(fileHandle);
+        throw std::runtime_error("could not create file mapping for '"
+                                 +fileName+"'");
+      }
+      data = (const unsigned char *)
+        MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, size);
+#else
+      int fd = ::open(fileName.c_str(), O_LARGEFILE | O_RDONLY);
+      if (fd == -1)
+        throw std::runtime_error("could not open file '"+fileName+"'");
+
+      struct stat st;
+      fstat(fd, &st);
+      size = st.st_size;
+
+      void *mem = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (mem == MAP_FAILED)
+        throw std::runtime_error("could not mmap file '"+fileName+"'");
+      data = (const unsigned char *)mem;
+#endif
+
+      if (!ioSlots) return;
+
+      // fault in every page, so the disk reads happen here, within the
+      // I/O limit, rather than wherever the data gets parsed
+#ifdef _WIN32
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      const size_t pageSize = info.dwPageSize;
+#else
+      const size_t pageSize = sysconf(_SC_PAGESIZE);
+#endif
+      const size_t pieceSize = size_t(16) << 20;
+      volatile unsigned char sink = 0;
+      for (size_t begin = 0; begin < size; begin += pieceSize) {
+        IOSlots::Slot slot(ioSlots);
+        const size_t end = std::min(size, begin + pieceSize);
+        for (size_t ofs = begin; ofs < end; ofs += pageSize)
+          sink += data[ofs];
+      }
+    }
+
+    size_t MappedFile::readableFrom(const void *ptr) const
+    {
+#ifdef _WIN32
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      const size_t pageSize = info.dwPageSize;
+#else
+      const size_t pageSize = sysconf(_SC_PAGESIZE);
+#endif
+      const size_t mappedSize = (size + pageSize - 1) / pageSize * pageSize;
+      const size_t offset = (const unsigned char *)ptr - data;
+      return offset < mappedSize ? mappedSize - offset : 0;
+    }
+
+    /*! a mesh's positions, copied out of a mapped file with padding */
+    struct PaddedPositions : public RefCount
+    {
+      Ref<RefCount>      owner;    /*!< keeps the other shared arrays alive */
+      std::vector<vec3f> position; /*!< positions, plus one for padding */
+    };
+
+    void padSharedPositions(Mesh &mesh, const MappedFile &file)
+    {
+      SharedArrays &shared = mesh.shared;
+      if (!shared.position) return;
+
+      const vec3f *end = shared.position + shared.numVertices;
+      if (file.readableFrom(end) >= sizeof(float)) return;
+
+      Ref<PaddedPositions> padded = new PaddedPositions;
+      padded->owner = shared.owner;
+      padded->position.resize(shared.numVertices + 1, vec3f(0.f));
+      std::copy(shared.position, end, padded->position.begin());
+
+      shared.owner    = padded.ptr;
+      shared.position = &padded->position[0];
+    }
+
+    MappedFile::~MappedFile()
+    {
+#ifdef _WIN32
+      UnmapViewOfFile(data);
+      CloseHandle(mappingHandle);
+      CloseHandle(fileHandle);
+#else
+      munmap((void *)data, size);
+#endif
+    }
+
+    LimitedFileBuffer::LimitedFileBuffer(const std::string &fileName,
+                                         IOSlots *ioSlots)
+      : file(fopen(fileName.c_str(), "rb")),
+        ioSlots(ioSlots),
+        buffer(size_t(4) << 20)
+    {
+      setg(buffer.data(), buffer.data(), buffer.data());
+    }
+
+    LimitedFileBuffer::~LimitedFileBuffer()
+    {
+      if (file) fclose(file);
+    }
+
+    LimitedFileBuffer::int_type LimitedFileBuffer::underflow()
+    {
+      if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+      if (!file)
+        return traits_type::eof();
+
+      size_t numRead;
+      {
+        IOSlots::Slot slot(ioSlots);
+        numRead = fread(buffer.data(), 1, buffer.size(), file);
+      }
+      if (numRead == 0)
+        return traits_type::eof();
+
+      setg(buffer.data(), buffer.data(), buffer.data() + numRead);
+      return traits_type::to_int_type(*gptr());
+    }
+
+    size_t numBlocksFor(size_t num, size_t minBlockSize)
+    {
+      const size_t numThreads =
+        std::max(size_t(1), size_t(std::thread::hardware_concurrency()));
+      return std::max(size_t(1),
+                      std::min(4*numThreads, num / minBlockSize));
+    }
+
+    box3f xfmBounds(const affine3f &xfm, const box3f &b)
+    {
+      box3f result = ospcommon::empty;
+      if (b.empty()) return result;
+      for (int i = 0; i < 8; i++) {
+        const vec3f corner((i & 1) ? b.upper.x : b.lower.x,
+                           (i & 2) ? b.upper.y : b.lower.y,
+                           (i & 4) ? b.upper.z : b.lower.z);
+        result.extend(xfmPoint(xfm, corner));
+      }
+      return result;
+    }
+
   } // ::ospray::minisg
 } // ::ospray
@@ -21,7 +21,10 @@
 // minisg stuff
 #include "miniSG.h"
 // stl stuff
+#include <cstdio>
 #include <map>
+#include <streambuf>
+#include <vector>
 
 namespace ospray {
   namespace miniSG {
@@ -56,5 +59,73 @@ namespace ospray {
       void finalize();
     };
 
+    /*! read-only memory mapping of an entire file; gets unmapped once
+        the last reference to it goes away */
+    struct MappedFile : public RefCount
+    {
+      /*! map the given file; throws a std::runtime_error on failure. if
+          'ioSlots' is given, the file gets read into the mapping right
+          away, one piece at a time while holding one of its slots */
+      MappedFile(const std::string &fileName, IOSlots *ioSlots = nullptr);
+      ~MappedFile();
+
+      const unsigned char *data; /*!< start of the mapped file */
+      size_t size;               /*!< size of the file, in bytes */
+
+      /*! number of bytes that can be read from 'ptr' (inside the
+          mapping) on; the rest of the last page reads as zeros, so this
+          can be a bit more than what is left of the file */
+      size_t readableFrom(const void *ptr) const;
+
+    private:
+#ifdef _WIN32
+      void *fileHandle;
+      void *mappingHandle;
+#endif
+    };
+
+    /*! stream buffer over a file that reads large pieces of it at a
+        time, each while holding one of the slots of 'ioSlots' (if
+        given), so a std::istream on it can be parsed line by line
+        without taking a slot per line */
+    class LimitedFileBuffer : public std::streambuf
+    {
+    public:
+      LimitedFileBuffer(const std::string &fileName, IOSlots *ioSlots);
+      ~LimitedFileBuffer();
+
+      bool isOpen() const { return file != nullptr; }
+
+    protected:
+      int_type underflow() override;
+
+    private:
+      FILE             *file;
+      IOSlots          *ioSlots;
+      std::vector<char> buffer;
+    };
+
+    /*! world-space bounds of the box 'b' transformed by 'xfm' */
+    box3f xfmBounds(const affine3f &xfm, const box3f &b);
+
+    /*! true if the two boxes share at least one point */
+    inline bool overlaps(const box3f &a, const box3f &b)
+    {
+      return a.lower.x <= b.upper.x && b.lower.x <= a.upper.x &&
+             a.lower.y <= b.upper.y && b.lower.y <= a.upper.y &&
+             a.lower.z <= b.upper.z && b.lower.z <= a.upper.z;
+    }
+
+    /*! embree reads the last vertex of a vertex array with a 16-byte
+        load, so vec3f positions shared straight from 'file' need 4 more
+        readable bytes behind them. if the file doesn't have those (its
+        data ends right at a page boundary), the mesh's shared positions
+        get replaced by a padded copy */
+    void padSharedPositions(Mesh &mesh, const MappedFile &file);
+
+    /*! number of parallel tasks to split 'num' items into, such that
+        each task gets at least about 'minBlockSize' items */
+    size_t numBlocksFor(size_t num, size_t minBlockSize);
+
   } // ::ospray::minisg
 } // ::ospray
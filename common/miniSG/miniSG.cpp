@@ -15,6 +15,15 @@
 // ======================================================================== //
 
 #include "miniSG.h"
+// stl
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 
 #ifdef USE_IMAGEMAGICK
 //#define MAGICKCORE_QUANTUM_DEPTH 16
@@ -29,6 +38,37 @@ using namespace Magick;
 namespace ospray {
   namespace miniSG {
 
+    IOSlots::IOSlots(int numSlots)
+      : numFree(std::max(1, numSlots))
+    {}
+
+    void IOSlots::acquire()
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      released.wait(lock, [&]() { return numFree > 0; });
+      numFree--;
+    }
+
+    void IOSlots::release()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        numFree++;
+      }
+      released.notify_one();
+    }
+
+    IOSlots::Slot::Slot(IOSlots *slots)
+      : slots(slots)
+    {
+      if (slots) slots->acquire();
+    }
+
+    IOSlots::Slot::~Slot()
+    {
+      if (slots) slots->release();
+    }
+
     Texture2D::Texture2D()
       : channels(0)
       , depth(0)
@@ -44,22 +84,57 @@ namespace ospray {
       // setParam( "Ka", vec3f(0.f) );
     }
 
-    Texture2D *loadTexture(const std::string &path, const std::string &fileNameBase, const bool prefereLinear)
+    /*! flip an image in y, because OSPRay's textures have the origin
+        at the lower left corner */
+    static void flipRows(void *data, size_t rowSize, int height)
     {
-      const FileName fileName = path+"/"+fileNameBase;
+      unsigned char *texels = (unsigned char *)data;
+      std::vector<unsigned char> tmp(rowSize);
+      for (int y = 0; y < height/2; y++) {
+        unsigned char *top    = texels + y*rowSize;
+        unsigned char *bottom = texels + (height-1-y)*rowSize;
+        memcpy(&tmp[0], top, rowSize);
+        memcpy(top, bottom, rowSize);
+        memcpy(bottom, &tmp[0], rowSize);
+      }
+    }
 
-      static std::map<std::string,Texture2D*> textureCache;
-      if (textureCache.find(fileName.str()) != textureCache.end()) 
-        return textureCache[fileName.str()];
+#ifdef USE_IMAGEMAGICK
+    /*! the entire content of the given file, read while holding one of
+        the slots of 'ioSlots' (if given) */
+    static Blob readImageFile(const FileName &fileName, IOSlots *ioSlots)
+    {
+      IOSlots::Slot slot(ioSlots);
+      FILE *file = fopen(fileName.str().c_str(), "rb");
+      if (!file)
+        throw std::runtime_error("could not open file");
+      std::vector<char> content;
+      char buffer[1<<16];
+      size_t numRead;
+      while ((numRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        content.insert(content.end(), buffer, buffer + numRead);
+      fclose(file);
+      return Blob(content.data(), content.size());
+    }
+#endif
 
-      Texture2D *tex = nullptr;
+    /*! decode the given image file into 'tex'; on failure the texture
+        is left without data. the file gets read while holding one of
+        the slots of 'ioSlots' (if given) */
+    static void decodeTexture(Texture2D *tex, const FileName &fileName,
+                              IOSlots *ioSlots)
+    {
       const std::string ext = fileName.ext();
       if (ext == "ppm") {
+        FILE *file = nullptr;
         try {
           int rc, peekchar;
 
+          // a ppm file's header is tiny, so all of the rest is reading
+          std::unique_ptr<IOSlots::Slot> slot(new IOSlots::Slot(ioSlots));
+
           // open file
-          FILE *file = fopen(fileName.str().c_str(),"rb");
+          file = fopen(fileName.str().c_str(),"rb");
           const int LINESZ=10000;
           char lineBuf[LINESZ+1]; 
 
@@ -108,65 +183,214 @@ namespace ospray {
             throw std::runtime_error("#osp:miniSG: could not parse P6 PPM file '"+fileName.str()+"': currently supporting only maxVal=255 formats."
                                      "Please report this bug at ospray.github.io, and include named file to reproduce the error.");
         
-          tex = new Texture2D;
+          const size_t rowSize = size_t(width)*3;
+          tex->texels.resize(rowSize*height);
+          rc = fread(&tex->texels[0],rowSize*height,1,file);
+          fclose(file);
+          file = nullptr;
+          slot.reset();
+          flipRows(&tex->texels[0], rowSize, height);
+
           tex->width    = width;
           tex->height   = height;
           tex->channels = 3;
           tex->depth    = 1;
-          tex->prefereLinear = prefereLinear;
-          tex->data     = new unsigned char[width*height*3];
-          rc = fread(tex->data,width*height*3,1,file);
-          // flip in y, because OSPRay's textures have the origin at the lower left corner
-          unsigned char *texels = (unsigned char *)tex->data;
-          for (int y = 0; y < height/2; y++)
-            for (int x = 0; x < width*3; x++)
-              std::swap(texels[y*width*3+x], texels[(height-1-y)*width*3+x]);
+          tex->data     = &tex->texels[0];
         } catch(std::runtime_error e) {
+          if (file) fclose(file);
           std::cerr << e.what() << std::endl;
         }
       } else {
 #ifdef USE_IMAGEMAGICK
-        Magick::Image image(fileName.str().c_str());
-        tex = new Texture2D;
-        tex->width    = image.columns();
-        tex->height   = image.rows();
-        tex->channels = image.matte() ? 4 : 3;
-        tex->depth    = 4;
-        tex->prefereLinear = prefereLinear;
-        float rcpMaxRGB = 1.0f/float(MaxRGB);
-        const Magick::PixelPacket* pixels = image.getConstPixels(0,0,tex->width,tex->height);
-        if (!pixels) {
-          std::cerr << "#osp:minisg: failed to load texture '"+fileName.str()+"'" << std::endl;
-          delete tex; 
-          tex = nullptr;
-        } else {
-          tex->data = new float[tex->width*tex->height*tex->channels];
-          // convert pixels and flip image (because OSPRay's textures have the origin at the lower left corner)
-          for (size_t y=0; y<tex->height; y++) {
-            for (size_t x=0; x<tex->width; x++) {
-              const Magick::PixelPacket &pixel = pixels[y*tex->width+x];
-              float *dst = &((float*)tex->data)[(x+(tex->height-1-y)*tex->width)*tex->channels];
-              *dst++ = pixel.red * rcpMaxRGB;
-              *dst++ = pixel.green * rcpMaxRGB;
-              *dst++ = pixel.blue * rcpMaxRGB;
-              if (tex->channels == 4)
-                *dst++ = pixel.opacity * rcpMaxRGB;
+        try {
+          Magick::Image image(readImageFile(fileName, ioSlots));
+          const int width    = image.columns();
+          const int height   = image.rows();
+          const int channels = image.matte() ? 4 : 3;
+          float rcpMaxRGB = 1.0f/float(MaxRGB);
+          const Magick::PixelPacket* pixels = image.getConstPixels(0,0,width,height);
+          if (!pixels) {
+            std::cerr << "#osp:minisg: failed to load texture '"+fileName.str()+"'" << std::endl;
+          } else {
+            tex->texels.resize(sizeof(float)*width*height*channels);
+            float *texels = (float *)&tex->texels[0];
+            // convert pixels and flip image (because OSPRay's textures have the origin at the lower left corner)
+            for (int y=0; y<height; y++) {
+              for (int x=0; x<width; x++) {
+                const Magick::PixelPacket &pixel = pixels[y*width+x];
+                float *dst = &texels[(x+(height-1-y)*width)*channels];
+                *dst++ = pixel.red * rcpMaxRGB;
+                *dst++ = pixel.green * rcpMaxRGB;
+                *dst++ = pixel.blue * rcpMaxRGB;
+                if (channels == 4)
+                  *dst++ = pixel.opacity * rcpMaxRGB;
+              }
             }
+            tex->width    = width;
+            tex->height   = height;
+            tex->channels = channels;
+            tex->depth    = 4;
+            tex->data     = texels;
           }
+        } catch (std::exception &e) {
+          std::cerr << "#osp:minisg: failed to load texture '"+fileName.str()+"': " << e.what() << std::endl;
         }
 #endif
       }
-      textureCache[fileName.str()] = tex;
-      return tex;
     }
 
+    /*! loads textures on a small pool of worker threads; requests for
+        the same file share a single Texture2D */
+    class TextureLoader
+    {
+    public:
+      TextureLoader() : numPending(0), quit(false) {}
+
+      ~TextureLoader()
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          quit = true;
+        }
+        workAvailable.notify_all();
+        for (size_t i = 0; i < workers.size(); i++)
+          workers[i].join();
+      }
+
+      Texture2D *load(const FileName &fileName, bool prefereLinear,
+                      IOSlots *ioSlots)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(fileName.str());
+        if (it != cache.end())
+          return it->second.ptr;
+
+        Texture2D *tex = new Texture2D;
+        tex->prefereLinear = prefereLinear;
+        tex->fileName = fileName.str();
+        cache[fileName.str()] = tex;
+
+        queue.push_back(Job{tex, fileName, ioSlots});
+        numPending++;
+        if (workers.size() < maxWorkers())
+          workers.push_back(std::thread([this]() { work(); }));
+        workAvailable.notify_one();
+        return tex;
+      }
+
+      void wait()
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        allDone.wait(lock, [this]() { return numPending == 0; });
+      }
+
+    private:
+
+      static size_t maxWorkers()
+      {
+        const size_t numThreads = std::thread::hardware_concurrency();
+        return std::max(size_t(1), std::min(numThreads, size_t(8)));
+      }
+
+      void work()
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+          workAvailable.wait(lock, [this]() { return quit || !queue.empty(); });
+          if (queue.empty()) return;
+
+          Job job = queue.front();
+          queue.pop_front();
+
+          lock.unlock();
+          decodeTexture(job.tex, job.fileName, job.ioSlots);
+          lock.lock();
+
+          if (--numPending == 0)
+            allDone.notify_all();
+        }
+      }
+
+      std::mutex mutex;
+      std::condition_variable workAvailable;
+      std::condition_variable allDone;
+      std::map<std::string, Ref<Texture2D> > cache;
+
+      struct Job {
+        Texture2D *tex;
+        FileName   fileName;
+        IOSlots   *ioSlots;
+      };
+      std::deque<Job> queue;
+      std::vector<std::thread> workers;
+      size_t numPending;
+      bool quit;
+    };
+
+    static TextureLoader &textureLoader()
+    {
+      static TextureLoader loader;
+      return loader;
+    }
+
+    Texture2D *loadTexture(const std::string &path, const std::string &fileNameBase, const bool prefereLinear,
+                           IOSlots *ioSlots)
+    {
+      const FileName fileName = path+"/"+fileNameBase;
+      return textureLoader().load(fileName, prefereLinear, ioSlots);
+    }
+
+    void waitForTextures()
+    {
+      textureLoader().wait();
+    }
+
+    const char *internString(const char *str)
+    {
+      static std::mutex mutex;
+      static std::unordered_set<std::string> strings;
+      std::lock_guard<std::mutex> lock(mutex);
+      return strings.insert(str).first->c_str();
+    }
+
+    /*! index of the parameter with the given name, or -1. names in the
+        list are interned, so an interned 'name' (eg, one taken from
+        another material) is found by pointer alone; only other strings
+        need to get compared */
+    static int indexOfParam(const Material::ParamList &params,
+                            const char *name)
+    {
+      for (size_t i = 0; i < params.size(); i++)
+        if (params[i].name == name)
+          return int(i);
+      for (size_t i = 0; i < params.size(); i++)
+        if (!strcmp(params[i].name, name))
+          return int(i);
+      return -1;
+    }
+
+    const Material::Param *Material::findParam(const char *name) const
+    {
+      const int i = indexOfParam(params, name);
+      return i < 0 ? nullptr : &params[i];
+    }
+
+    Material::Param &Material::findOrAddParam(const char *name)
+    {
+      const int i = indexOfParam(params, name);
+      if (i >= 0)
+        return params[i];
+      params.push_back(Param());
+      params.back().name = internString(name);
+      return params.back();
+    }
 
     float Material::getParam(const char *name, float defaultVal) 
     {
-      ParamMap::iterator it = params.find(name);
-      if (it != params.end()) {
-        assert( it->second->type == Param::FLOAT && "Param type mismatch" );
-        return it->second->f[0];
+      const Param *p = findParam(name);
+      if (p) {
+        assert( p->type == Param::FLOAT && "Param type mismatch" );
+        return p->f[0];
       }
 
       return defaultVal;
@@ -174,10 +398,10 @@ namespace ospray {
     
     vec2f Material::getParam(const char *name, vec2f defaultVal) 
     {
-      ParamMap::iterator it = params.find(name);
-      if (it != params.end()) {
-        assert( it->second->type == Param::FLOAT_2 && "Param type mismatch" );
-        return vec2f(it->second->f[0], it->second->f[1]);
+      const Param *p = findParam(name);
+      if (p) {
+        assert( p->type == Param::FLOAT_2 && "Param type mismatch" );
+        return vec2f(p->f[0], p->f[1]);
       }
 
       return defaultVal;
@@ -185,10 +409,10 @@ namespace ospray {
 
     vec3f Material::getParam(const char *name, vec3f defaultVal) 
     {
-      ParamMap::iterator it = params.find(name);
-      if (it != params.end()) {
-        assert( it->second->type == Param::FLOAT_3 && "Param type mismatch" );
-        return vec3f( it->second->f[0], it->second->f[1], it->second->f[2] );
+      const Param *p = findParam(name);
+      if (p) {
+        assert( p->type == Param::FLOAT_3 && "Param type mismatch" );
+        return vec3f( p->f[0], p->f[1], p->f[2] );
       }
 
       return defaultVal;
@@ -196,10 +420,10 @@ namespace ospray {
 
     vec4f Material::getParam(const char *name, vec4f defaultVal) 
     {
-      ParamMap::iterator it = params.find(name);
-      if (it != params.end()) {
-        assert( it->second->type == Param::FLOAT_4 && "Param type mismatch" );
-        return vec4f( it->second->f[0], it->second->f[1], it->second->f[2], it->second->f[3] );
+      const Param *p = findParam(name);
+      if (p) {
+        assert( p->type == Param::FLOAT_4 && "Param type mismatch" );
+        return vec4f( p->f[0], p->f[1], p->f[2], p->f[3] );
       }
 
       return defaultVal;
@@ -207,10 +431,10 @@ namespace ospray {
 
     int32_t Material::getParam(const char *name, int32_t defaultVal) 
     {
-      ParamMap::iterator it = params.find(name);
-      if (it != params.end()) {
-        assert( it->second->type == Param::INT && "Param type mismatch" );
-        return it->second->i[0];
+      const Param *p = findParam(name);
+      if (p) {
+        assert( p->type == Param::INT && "Param type mismatch" );
+        return p->i[0];
       }
 
       return defaultVal;
@@ -218,10 +442,10 @@ namespace ospray {
 
     vec2i Material::getParam(const char *name, vec2i defaultVal) 
     {
-      ParamMap::iterator it = params.find(name);
-      if (it != params.end()) {
-        assert( it->second->type == Param::INT_2 && "Param type mismatch" );
-        return vec2i(it->second->i[0], it->second->i[1]);
+      const Param *p = findParam(name);
+      if (p) {
+        assert( p->type == Param::INT_2 && "Param type mismatch" );
+        return vec2i(p->i[0], p->i[1]);
       }
 
       return defaultVal;
@@ -229,10 +453,10 @@ namespace ospray {
 
     vec3i Material::getParam(const char *name, vec3i defaultVal) 
     {
-      ParamMap::iterator it = params.find(name);
-      if (it != params.end()) {
-        assert( it->second->type == Param::INT_3 && "Param type mismatch" );
-        return vec3i(it->second->i[0], it->second->i[1], it->second->i[2]);
+      const Param *p = findParam(name);
+      if (p) {
+        assert( p->type == Param::INT_3 && "Param type mismatch" );
+        return vec3i(p->i[0], p->i[1], p->i[2]);
       }
 
       return defaultVal;
@@ -240,10 +464,10 @@ namespace ospray {
 
     vec4i Material::getParam(const char *name, vec4i defaultVal) 
     {
-      ParamMap::iterator it = params.find(name);
-      if (it != params.end()) {
-        assert( it->second->type == Param::INT_4 && "Param type mismatch" );
-        return vec4i(it->second->i[0], it->second->i[1], it->second->i[2], it->second->i[3]);
+      const Param *p = findParam(name);
+      if (p) {
+        assert( p->type == Param::INT_4 && "Param type mismatch" );
+        return vec4i(p->i[0], p->i[1], p->i[2], p->i[3]);
       }
 
       return defaultVal;
@@ -252,10 +476,10 @@ namespace ospray {
 
     uint32_t Material::getParam(const char *name, uint32_t defaultVal) 
     {
-      ParamMap::iterator it = params.find(name);
-      if (it != params.end()) {
-        assert( it->second->type == Param::UINT && "Param type mismatch" );
-        return it->second->ui[0];
+      const Param *p = findParam(name);
+      if (p) {
+        assert( p->type == Param::UINT && "Param type mismatch" );
+        return p->ui[0];
       }
 
       return defaultVal;
@@ -263,10 +487,10 @@ namespace ospray {
 
     vec2ui Material::getParam(const char *name, vec2ui defaultVal) 
     {
-      ParamMap::iterator it = params.find(name);
-      if (it != params.end()) {
-        assert( it->second->type == Param::UINT_2 && "Param type mismatch" );
-        return vec2ui(it->second->ui[0], it->second->ui[1]);
+      const Param *p = findParam(name);
+      if (p) {
+        assert( p->type == Param::UINT_2 && "Param type mismatch" );
+        return vec2ui(p->ui[0], p->ui[1]);
       }
 
       return defaultVal;
@@ -274,10 +498,10 @@ namespace ospray {
 
     vec3ui Material::getParam(const char *name, vec3ui defaultVal) 
     {
-      ParamMap::iterator it = params.find(name);
-      if (it != params.end()) {
-        assert( it->second->type == Param::UINT_3 && "Param type mismatch" );
-        return vec3ui(it->second->ui[0], it->second->ui[1], it->second->ui[2]);
+      const Param *p = findParam(name);
+      if (p) {
+        assert( p->type == Param::UINT_3 && "Param type mismatch" );
+        return vec3ui(p->ui[0], p->ui[1], p->ui[2]);
       }
 
       return defaultVal;
@@ -285,10 +509,10 @@ namespace ospray {
 
     vec4ui Material::getParam(const char *name, vec4ui defaultVal) 
     {
-      ParamMap::iterator it = params.find(name);
-      if (it != params.end()) {
-        assert( it->second->type == Param::UINT_4 && "Param type mismatch" );
-        return vec4ui(it->second->ui[0], it->second->ui[1], it->second->ui[2], it->second->ui[3]);
+      const Param *p = findParam(name);
+      if (p) {
+        assert( p->type == Param::UINT_4 && "Param type mismatch" );
+        return vec4ui(p->ui[0], p->ui[1], p->ui[2], p->ui[3]);
       }
 
       return defaultVal;
@@ -296,10 +520,10 @@ namespace ospray {
 
     const char *Material::getParam(const char *name, const char *defaultVal) 
     {
-      ParamMap::iterator it = params.find(name);
-      if (it != params.end()) {
-        assert( it->second->type == Param::STRING && "Param type mismatch" );
-        return it->second->s;
+      const Param *p = findParam(name);
+      if (p) {
+        assert( p->type == Param::STRING && "Param type mismatch" );
+        return p->s;
       }
 
       return defaultVal;
@@ -307,10 +531,10 @@ namespace ospray {
 
     void *Material::getParam(const char *name, void *defaultVal) 
     {
-      ParamMap::iterator it = params.find(name);
-      if (it != params.end()) {
-        assert( it->second->type == Param::TEXTURE /*|| other 'data' types*/&& "Param type mismatch" );
-        return it->second->ptr;
+      const Param *p = findParam(name);
+      if (p) {
+        assert( p->type == Param::TEXTURE /*|| other 'data' types*/&& "Param type mismatch" );
+        return p->ptr;
       }
 
       return defaultVal;
@@ -332,12 +556,75 @@ namespace ospray {
     box3f Mesh::getBBox() 
     {
       if (bounds.empty()) {
-        for (size_t i = 0; i < position.size(); i++)
-          bounds.extend(position[i]);
+        if (hasSharedArrays()) {
+          for (size_t i = 0; i < shared.numVertices; i++)
+            bounds.extend(shared.position[i]);
+        } else {
+          for (size_t i = 0; i < position.size(); i++)
+            bounds.extend(position[i]);
+        }
       }
       return bounds;
     }
 
+    void Mesh::materialize()
+    {
+      if (!hasSharedArrays()) return;
+
+      const size_t numVertices = shared.numVertices;
+      position.resize(numVertices);
+      for (size_t i = 0; i < numVertices; i++)
+        position[i] = vec3fa(shared.position[i]);
+
+      if (shared.normal) {
+        normal.resize(numVertices);
+        for (size_t i = 0; i < numVertices; i++)
+          normal[i] = vec3fa(shared.normal[i]);
+      }
+
+      if (shared.texcoord)
+        texcoord.assign(shared.texcoord, shared.texcoord + numVertices);
+
+      triangle.resize(shared.numTriangles);
+      for (size_t i = 0; i < shared.numTriangles; i++) {
+        const int32_t *index = shared.index + i*shared.indexStride;
+        triangle[i].v0 = index[0];
+        triangle[i].v1 = index[1];
+        triangle[i].v2 = index[2];
+      }
+
+      shared = SharedArrays();
+    }
+
+    template<typename T>
+    static inline size_t bytesOf(const std::vector<T> &array)
+    {
+      return array.size() * sizeof(T);
+    }
+
+    template<typename T>
+    static inline void release(std::vector<T> &array)
+    {
+      std::vector<T>().swap(array);
+    }
+
+    size_t Mesh::sizeInBytes() const
+    {
+      return bytesOf(position) + bytesOf(normal) + bytesOf(color)
+        + bytesOf(texcoord) + bytesOf(triangle) + bytesOf(triangleMaterialId);
+    }
+
+    void Mesh::releaseArrays()
+    {
+      getBBox();
+      release(position);
+      release(normal);
+      release(color);
+      release(texcoord);
+      release(triangle);
+      release(triangleMaterialId);
+    }
+
     /*! computes and returns the world-space bounding box of the entire model */
     box3f Model::getBBox() 
     {
@@ -372,7 +659,7 @@ namespace ospray {
     {
       size_t sum = 0;
       for (size_t i = 0; i < mesh.size(); i++)
-        sum += mesh[i]->triangle.size();
+        sum += mesh[i]->numTriangles();
       return sum;
     }
 
@@ -26,6 +26,8 @@
 #include "ospcommon/FileName.h"
 
 // stl 
+#include <condition_variable>
+#include <mutex>
 #include <vector>
 #include <map>
 
@@ -38,6 +40,36 @@ namespace ospray {
       vec3f from, at, up;
     };
 
+    /*! counting semaphore that limits how many importers read from disk
+        at the same time. importers hold one of its slots while they
+        read (or fault in the pages of a mapping), but not while they
+        parse what they read */
+    class IOSlots
+    {
+    public:
+      IOSlots(int numSlots);
+
+      void acquire();
+      void release();
+
+      /*! holds one of the slots of 'slots' for as long as it lives; a
+          null 'slots' means no limit */
+      class Slot
+      {
+      public:
+        Slot(IOSlots *slots);
+        ~Slot();
+
+      private:
+        IOSlots *slots;
+      };
+
+    private:
+      std::mutex              mutex;
+      std::condition_variable released;
+      int                     numFree;
+    };
+
     struct Texture2D : public RefCount {
       Texture2D();
 
@@ -47,12 +79,32 @@ namespace ospray {
       int width;    //Pixels per row
       int height;   //Pixels per column
       void *data;   //Pointer to binary texture data
+      std::vector<unsigned char> texels; //Texel storage owned by the texture;
+                                         //'data' points here if non-empty
+      Ref<RefCount> owner; //Keeps 'data' alive if it points into memory
+                           //owned by someone else (eg, a mapped file)
+      std::string fileName; //File the texture got loaded from, if any
     };
     
-    Texture2D *loadTexture(const std::string &path, const std::string &fileName, const bool prefereLinear = false);
+    /*! request a texture; the returned texture is decoded in the
+        background, and only valid after waitForTextures(). textures
+        that fail to load end up with 'data' set to nullptr. safe to
+        call from multiple threads. if 'ioSlots' is given, the file gets
+        read while holding one of its slots */
+    Texture2D *loadTexture(const std::string &path, const std::string &fileName, const bool prefereLinear = false,
+                           IOSlots *ioSlots = nullptr);
+    /*! block until all textures requested so far are decoded */
+    void waitForTextures();
+
+    /*! returns a copy of 'str' that lives as long as the program;
+        equal strings always give the same pointer. safe to call from
+        multiple threads */
+    const char *internString(const char *str);
 
     struct Material : public RefCount {
-      struct Param : public RefCount {
+      /*! a single material parameter; small values are stored inline,
+          names and string values are interned (\see internString()) */
+      struct Param {
         typedef enum {
           INT,
           INT_2,
@@ -71,51 +123,32 @@ namespace ospray {
           UNKNOWN,
         } DataType;
 
-        void clear() {
-          switch( type ) {
-            case STRING:
-              if (s) free((void*)s);
-              s = nullptr;
-              break;
-            case TEXTURE:
-              ptr = nullptr;
-              break;
-            default:
-              type = TEXTURE;
-              ptr = nullptr;
-          };
-        }
-
-        void set(const char *v) { 
-          clear();
-          s = strdup(v);
-          type = STRING;
-          // char *str = (char*)malloc(strlen(v));
-          // strcpy(str, v);
-          // s = str;
-        }
+        void set(const char *v) { type = STRING; s = internString(v); }
 
-        void set(void *v, DataType t = UNKNOWN) { clear(); type = t; ptr = v; }
+        void set(void *v, DataType t = UNKNOWN) { type = t; ptr = v; }
 
-        void set(float v) { clear(); type = FLOAT; f[0] = v; }
-        void set(vec2f v) { clear(); type = FLOAT_2; f[0] = v.x; f[1] = v.y; }
-        void set(vec3f v) { clear(); type = FLOAT_3; f[0] = v.x; f[1] = v.y; f[2] = v.z; }
-        void set(vec4f v) { clear(); type = FLOAT_3; f[0] = v.x; f[1] = v.y; f[2] = v.z; f[3] = v.w; }
+        void set(float v) { type = FLOAT; f[0] = v; }
+        void set(vec2f v) { type = FLOAT_2; f[0] = v.x; f[1] = v.y; }
+        void set(vec3f v) { type = FLOAT_3; f[0] = v.x; f[1] = v.y; f[2] = v.z; }
+        void set(vec4f v) { type = FLOAT_3; f[0] = v.x; f[1] = v.y; f[2] = v.z; f[3] = v.w; }
 
-        void set(int32_t v) { clear(); type = INT; i[0] = v; }
-        void set(vec2i v) { clear(); type = INT_2; i[0] = v.x; i[1] = v.y; }
-        void set(vec3i v) { clear(); type = INT_3; i[0] = v.x; i[1] = v.y; i[2] = v.z; }
-        void set(vec4i v) { clear(); type = INT_3; i[0] = v.x; i[1] = v.y; i[2] = v.z; i[3] = v.w; }
+        void set(int32_t v) { type = INT; i[0] = v; }
+        void set(vec2i v) { type = INT_2; i[0] = v.x; i[1] = v.y; }
+        void set(vec3i v) { type = INT_3; i[0] = v.x; i[1] = v.y; i[2] = v.z; }
+        void set(vec4i v) { type = INT_3; i[0] = v.x; i[1] = v.y; i[2] = v.z; i[3] = v.w; }
 
-        void set(uint32_t v) { clear(); type = UINT; i[0] = v; }
-        void set(vec2ui v) { clear(); type = UINT_2; i[0] = v.x; i[1] = v.y; }
-        void set(vec3ui v) { clear(); type = UINT_3; i[0] = v.x; i[1] = v.y; i[2] = v.z; }
-        void set(vec4ui v) { clear(); type = UINT_3; i[0] = v.x; i[1] = v.y; i[2] = v.z; i[3] = v.w; }
+        void set(uint32_t v) { type = UINT; i[0] = v; }
+        void set(vec2ui v) { type = UINT_2; i[0] = v.x; i[1] = v.y; }
+        void set(vec3ui v) { type = UINT_3; i[0] = v.x; i[1] = v.y; i[2] = v.z; }
+        void set(vec4ui v) { type = UINT_3; i[0] = v.x; i[1] = v.y; i[2] = v.z; i[3] = v.w; }
 
         Param() {
+          name = nullptr;
           s = nullptr;
           type = INT;
         }
+
+        const char *name;
         union {
           float      f[4];
           int32_t      i[4];
@@ -127,7 +160,7 @@ namespace ospray {
         DataType type;
       };
 
-      typedef std::map< std::string, Ref<Param> > ParamMap;
+      typedef std::vector<Param> ParamList;
 
       Material();
 
@@ -152,25 +185,21 @@ namespace ospray {
       //At least we can be lazy when setting parameters
       template< typename T >
         void setParam(const char *name, T v) {
-          //Clean up old parameter
-          ParamMap::iterator it = params.find(name);
-          if(it != params.end() ) params.erase(it);
-          Param *p = new Param;
-          p->set(v);
-          params[name] = p;
+          findOrAddParam(name).set(v);
         }
 
       void setParam(const char *name, void *v, Param::DataType t = Param::TEXTURE) {
-        ParamMap::iterator it = params.find(name);
-        if(it != params.end() ) params.erase(it);
-        Param *p = new Param;
-        p->set(v, t);
-        params[name] = p;
+        findOrAddParam(name).set(v, t);
       }
 
+      /*! returns the parameter with given name, or nullptr if not set */
+      const Param *findParam(const char *name) const;
+      /*! returns the parameter with given name, adding it if not set */
+      Param &findOrAddParam(const char *name);
+
       std::string toString() const { return "miniSG::Material"; }
 
-      ParamMap params;
+      ParamList params;
       std::vector<Ref<Texture2D> > textures;
       std::string name;
       std::string type;
@@ -180,6 +209,26 @@ namespace ospray {
       uint32_t v0, v1, v2;
     };
 
+    /*! vertex and index arrays that live in memory owned by someone
+        else, usually a mapped file. a mesh that has these leaves its
+        own position, normal, texcoord and triangle arrays empty until
+        Mesh::materialize() gets called; the one exception are normals
+        generated for a mesh that has no shared ones */
+    struct SharedArrays {
+      SharedArrays()
+        : position(nullptr), normal(nullptr), texcoord(nullptr),
+          index(nullptr), indexStride(4), numVertices(0), numTriangles(0) {}
+
+      Ref<RefCount> owner;   /*!< keeps the arrays below alive */
+      const vec3f *position; /*!< 'numVertices' vertex positions */
+      const vec3f *normal;   /*!< 'numVertices' normals, or nullptr */
+      const vec2f *texcoord; /*!< 'numVertices' texcoords, or nullptr */
+      const int32_t *index;  /*!< 'numTriangles' vertex ID triples */
+      int indexStride;       /*!< ints per triple: 3, or 4 if padded */
+      size_t numVertices;
+      size_t numTriangles;
+    };
+
     /*! default triangle mesh layout */
     struct Mesh : public RefCount {
       std::string           name;     /*!< symbolic name of mesh, can be empty */
@@ -207,7 +256,31 @@ namespace ospray {
       
       box3f bounds; /*!< bounding box of all vertices */
 
-      int size() const { return triangle.size(); }
+      /*! externally owned arrays, used instead of position, normal,
+          texcoord and triangle if present */
+      SharedArrays shared;
+
+      bool hasSharedArrays() const { return shared.position != nullptr; }
+      size_t numVertices() const
+      { return hasSharedArrays() ? shared.numVertices : position.size(); }
+      size_t numTriangles() const
+      { return hasSharedArrays() ? shared.numTriangles : triangle.size(); }
+
+      /*! copy shared arrays (if any) into the mesh's own arrays, so
+          they can be modified */
+      void materialize();
+
+      /*! bytes of vertex and index data held by the mesh itself, ie,
+          not counting shared arrays */
+      size_t sizeInBytes() const;
+      /*! free the mesh's own vertex, index, and material ID arrays (eg,
+          once they have been uploaded). the bounding box is computed
+          first and kept. shared arrays are left alone, since ospray may
+          still render from them; so afterwards numVertices() and
+          numTriangles() return 0 only for meshes without shared arrays */
+      void releaseArrays();
+
+      int size() const { return numTriangles(); }
       Ref<Material> material;
       box3f getBBox();
       Mesh() : bounds(ospcommon::empty) {};
@@ -229,12 +302,20 @@ namespace ospray {
     bool operator!=(const Instance &a, const Instance &b);
 
     struct Model : public RefCount {
+      Model() : regionOfInterest(ospcommon::empty), ioSlots(nullptr) {}
+
       /*! list of meshes that the scene is composed of */
       std::vector<Ref<Mesh> >     mesh;
       /*! \brief list of instances (if available). */
       std::vector<Instance>       instance;
       /*! \brief list of camera defined in the model (usually empty) */
       std::vector<Ref<Camera> >   camera;
+      /*! if not empty, importers may leave out geometry that lies
+          completely outside of this (world-space) box */
+      box3f                       regionOfInterest;
+      /*! if set, importers hold one of its slots while they read from
+          disk; it has to outlive the import */
+      IOSlots                    *ioSlots;
 
       //! return number of meshes in this model
       inline size_t numMeshes() const { return mesh.size(); }
@@ -262,12 +343,64 @@ namespace ospray {
     /*! import a list of STL files */
     void importSTL(std::vector<Model *> &animation, const FileName &fileName);
 
+    /*! return the STL files (one per time step) listed in an STL
+        animation file, without loading any of them */
+    std::vector<std::string> listSTLAnimation(const FileName &fileName);
+
     /*! import a list of X3D files */
     void importX3D(Model &model, const FileName &fileName);
 
     /*! import a MiniSG MSG file, and add it to the specified model */
     void importMSG(Model &model, const FileName &fileName);
 
+    /*! sort each mesh's triangles by the morton code of their
+        centroids and renumber its vertices in first-use order, to
+        improve the memory locality of BVH build and traversal */
+    void reorderForLocality(Model &model);
+    /*! spatially reorder a single mesh, \see reorderForLocality(Model&) */
+    void reorderForLocality(Mesh &mesh);
+
+    /*! merge meshes that are not instanced and share the same vertex
+        layout into batches of up to 'maxTrianglesPerBatch' triangles,
+        using per-primitive material IDs into a merged material list */
+    void batchMeshes(Model &model, size_t maxTrianglesPerBatch);
+
+    /*! find meshes that are identical to, or translated copies of,
+        another mesh (same topology, attributes and materials), and
+        replace them by instances of that mesh */
+    void detectInstances(Model &model);
+
+    /*! bake 'xfm' into the mesh: positions get transformed, normals get
+        transformed by the inverse transpose and re-normalized. meshes
+        with shared arrays get materialized first */
+    void transformMesh(Mesh &mesh, const affine3f &xfm);
+
+    /*! drop all instances whose world-space bounds do not overlap
+        'region', and the meshes no longer used by any instance */
+    void cropToRegion(Model &model, const box3f &region);
+
+    /*! if the textures used by the model take more than
+        'budgetInBytes', repeatedly box-filter the currently largest
+        texture down by one mip level until they fit */
+    void fitTexturesToBudget(Model &model, size_t budgetInBytes);
+
+    /*! (re-)compute the mesh's vertex normals from its triangles,
+        weighted by triangle area, or by the triangles' angles at each
+        vertex. meshes with shared arrays keep them, and get their own
+        'normal' array */
+    void generateNormals(Mesh &mesh, bool angleWeighted = false);
+    /*! generate normals for all meshes of the model that have none */
+    void generateNormals(Model &model, bool angleWeighted = false);
+
+    /*! build a simplified copy of the mesh with about 'ratio' times as
+        many vertices: vertices get clustered on a uniform grid, and
+        each cluster gets replaced by the point that minimizes the
+        quadric error of the triangles around it */
+    Ref<Mesh> simplify(const Mesh &mesh, float ratio);
+    /*! simplified copy of all meshes of the model, \see simplify(const
+        Mesh&,float); instances and cameras stay the same */
+    Ref<Model> simplify(const Model &model, float ratio);
+
     void error(const std::string &err);
 
   } // ::ospray::minisg
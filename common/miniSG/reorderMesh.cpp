@@ -0,0 +1,152 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "miniSG.h"
+// ospcommon
+#include "ospcommon/tasking/parallel_for.h"
+// stl
+#include <algorithm>
+
+namespace ospray {
+  namespace miniSG {
+
+    /*! spread the lower 21 bits of 'x' such that there are two zero
+        bits between each of them */
+    static inline uint64_t expandBits(uint64_t x)
+    {
+      x &= 0x1fffff;
+      x = (x | x << 32) & 0x1f00000000ffffull;
+      x = (x | x << 16) & 0x1f0000ff0000ffull;
+      x = (x | x <<  8) & 0x100f00f00f00f00full;
+      x = (x | x <<  4) & 0x10c30c30c30c30c3ull;
+      x = (x | x <<  2) & 0x1249249249249249ull;
+      return x;
+    }
+
+    /*! 63-bit morton code of a point, quantized to 21 bits per axis
+        relative to the given bounds */
+    static inline uint64_t mortonCode(const vec3f &p,
+                                      const vec3f &lower,
+                                      const vec3f &scale)
+    {
+      const vec3f q = (p - lower) * scale;
+      const uint64_t x = (uint64_t)std::max(0.f, std::min(q.x, 2097151.f));
+      const uint64_t y = (uint64_t)std::max(0.f, std::min(q.y, 2097151.f));
+      const uint64_t z = (uint64_t)std::max(0.f, std::min(q.z, 2097151.f));
+      return expandBits(x) | (expandBits(y) << 1) | (expandBits(z) << 2);
+    }
+
+    template<typename T>
+    static void permute(std::vector<T> &array,
+                        const std::vector<uint32_t> &newToOld)
+    {
+      if (array.empty()) return;
+      std::vector<T> reordered(newToOld.size());
+      for (size_t i = 0; i < newToOld.size(); i++)
+        reordered[i] = array[newToOld[i]];
+      array.swap(reordered);
+    }
+
+    /*! sort the triangles of the given mesh along a morton curve
+        through their centroids, and renumber the vertices in the order
+        in which the sorted triangles first use them */
+    void reorderForLocality(Mesh &mesh)
+    {
+      mesh.materialize();
+
+      const size_t numTriangles = mesh.triangle.size();
+      const size_t numVertices  = mesh.position.size();
+      if (numTriangles < 2) return;
+
+      // we can only renumber vertices if all vertex arrays are
+      // indexed the same way
+      if ((!mesh.normal.empty()   && mesh.normal.size()   != numVertices) ||
+          (!mesh.color.empty()    && mesh.color.size()    != numVertices) ||
+          (!mesh.texcoord.empty() && mesh.texcoord.size() != numVertices))
+        return;
+      if (!mesh.triangleMaterialId.empty() &&
+          mesh.triangleMaterialId.size() != numTriangles)
+        return;
+
+      const box3f bounds = mesh.getBBox();
+      if (bounds.empty()) return;
+      const vec3f lower  = bounds.lower;
+      const vec3f extent = max(bounds.upper - bounds.lower, vec3f(1e-20f));
+      const vec3f scale  = vec3f(2097151.f) / extent;
+
+      // ------------------------------------------------------------------
+      // sort triangles by the morton code of their centroid
+      // ------------------------------------------------------------------
+      std::vector<std::pair<uint64_t, uint32_t> > key(numTriangles);
+      for (size_t i = 0; i < numTriangles; i++) {
+        const Triangle &t = mesh.triangle[i];
+        const vec3f centroid = (vec3f(mesh.position[t.v0]) +
+                                vec3f(mesh.position[t.v1]) +
+                                vec3f(mesh.position[t.v2])) * (1.f/3.f);
+        key[i] = std::make_pair(mortonCode(centroid, lower, scale),
+                                (uint32_t)i);
+      }
+      std::sort(key.begin(), key.end());
+
+      std::vector<uint32_t> triOrder(numTriangles);
+      for (size_t i = 0; i < numTriangles; i++)
+        triOrder[i] = key[i].second;
+      key.clear();
+
+      permute(mesh.triangle, triOrder);
+      permute(mesh.triangleMaterialId, triOrder);
+
+      // ------------------------------------------------------------------
+      // renumber vertices in first-use order; vertices that no triangle
+      // references are kept at the end
+      // ------------------------------------------------------------------
+      const uint32_t invalid = (uint32_t)-1;
+      std::vector<uint32_t> oldToNew(numVertices, invalid);
+      std::vector<uint32_t> newToOld;
+      newToOld.reserve(numVertices);
+
+      for (size_t i = 0; i < numTriangles; i++) {
+        Triangle &t = mesh.triangle[i];
+        uint32_t *vtx[3] = { &t.v0, &t.v1, &t.v2 };
+        for (int j = 0; j < 3; j++) {
+          uint32_t &id = oldToNew[*vtx[j]];
+          if (id == invalid) {
+            id = newToOld.size();
+            newToOld.push_back(*vtx[j]);
+          }
+          *vtx[j] = id;
+        }
+      }
+      for (size_t i = 0; i < numVertices; i++)
+        if (oldToNew[i] == invalid) newToOld.push_back(i);
+
+      permute(mesh.position, newToOld);
+      permute(mesh.normal,   newToOld);
+      permute(mesh.color,    newToOld);
+      permute(mesh.texcoord, newToOld);
+    }
+
+    /*! apply reorderForLocality() to all meshes of the model, one mesh
+        per task */
+    void reorderForLocality(Model &model)
+    {
+      parallel_for(int(model.mesh.size()), [&](int meshID) {
+        reorderForLocality(*model.mesh[meshID]);
+      });
+    }
+
+  } // ::ospray::minisg
+} // ::ospray
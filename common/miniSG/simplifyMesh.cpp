@@ -0,0 +1,308 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "miniSG.h"
+// ospcommon
+#include "ospcommon/tasking/parallel_for.h"
+// stl
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace ospray {
+  namespace miniSG {
+    using std::cout;
+    using std::endl;
+
+    /*! symmetric 4x4 matrix of the squared distance to a set of planes
+        (Garland and Heckbert's error quadric) */
+    struct Quadric {
+      Quadric() { std::fill(q, q+10, 0.0); }
+
+      /*! quadric of the plane n.x + d = 0, weighted by 'w' */
+      Quadric(const vec3f &n, float d, float w)
+      {
+        q[0] = w*n.x*n.x; q[1] = w*n.x*n.y; q[2] = w*n.x*n.z; q[3] = w*n.x*d;
+                          q[4] = w*n.y*n.y; q[5] = w*n.y*n.z; q[6] = w*n.y*d;
+                                            q[7] = w*n.z*n.z; q[8] = w*n.z*d;
+                                                              q[9] = w*d*d;
+      }
+
+      Quadric &operator+=(const Quadric &o)
+      {
+        for (int i = 0; i < 10; i++) q[i] += o.q[i];
+        return *this;
+      }
+
+      /*! find the point with minimum error; returns false if that is
+          not well defined (eg, all planes are parallel) */
+      bool minimize(vec3f &p) const
+      {
+        const double a00 = q[0], a01 = q[1], a02 = q[2];
+        const double a11 = q[4], a12 = q[5], a22 = q[7];
+        const double c00 = a11*a22 - a12*a12;
+        const double c01 = a02*a12 - a01*a22;
+        const double c02 = a01*a12 - a02*a11;
+        const double det = a00*c00 + a01*c01 + a02*c02;
+        const double scale = a00*a00 + a11*a11 + a22*a22;
+        if (std::fabs(det) <= 1e-12 * scale * std::sqrt(scale)) return false;
+
+        const double c11 = a00*a22 - a02*a02;
+        const double c12 = a01*a02 - a00*a12;
+        const double c22 = a00*a11 - a01*a01;
+        const double b0 = -q[3], b1 = -q[6], b2 = -q[8];
+        p.x = float((c00*b0 + c01*b1 + c02*b2) / det);
+        p.y = float((c01*b0 + c11*b1 + c12*b2) / det);
+        p.z = float((c02*b0 + c12*b1 + c22*b2) / det);
+        return true;
+      }
+
+      double q[10];
+    };
+
+    /*! everything accumulated for one grid cell */
+    struct Cluster {
+      Cluster() : position(0.f), normal(0.f), color(0.f), texcoord(0.f),
+                  numVertices(0) {}
+      Quadric quadric;
+      vec3f position; /*!< sum of vertex positions */
+      vec3f normal;
+      vec3f color;
+      vec2f texcoord;
+      int   numVertices;
+    };
+
+    /*! read access to a mesh's own or shared arrays */
+    static inline vec3f positionOf(const Mesh &mesh, size_t i)
+    {
+      return mesh.hasSharedArrays() ? mesh.shared.position[i]
+                                    : vec3f(mesh.position[i]);
+    }
+
+    static inline Triangle triangleOf(const Mesh &mesh, size_t i)
+    {
+      if (!mesh.hasSharedArrays()) return mesh.triangle[i];
+      const int32_t *index = mesh.shared.index + i*mesh.shared.indexStride;
+      Triangle t;
+      t.v0 = index[0];
+      t.v1 = index[1];
+      t.v2 = index[2];
+      return t;
+    }
+
+    /*! unsimplified copy of a mesh; only (read-only) shared arrays stay
+        shared with it */
+    static Ref<Mesh> copyOf(const Mesh &mesh)
+    {
+      Ref<Mesh> copy = new Mesh;
+      copy->name               = mesh.name;
+      copy->position           = mesh.position;
+      copy->normal             = mesh.normal;
+      copy->color              = mesh.color;
+      copy->texcoord           = mesh.texcoord;
+      copy->triangle           = mesh.triangle;
+      copy->materialList       = mesh.materialList;
+      copy->triangleMaterialId = mesh.triangleMaterialId;
+      copy->bounds             = mesh.bounds;
+      copy->shared             = mesh.shared;
+      copy->material           = mesh.material;
+      return copy;
+    }
+
+    Ref<Mesh> simplify(const Mesh &mesh, float ratio)
+    {
+      const size_t numVertices  = mesh.numVertices();
+      const size_t numTriangles = mesh.numTriangles();
+
+      Ref<Mesh> result = new Mesh;
+      result->name         = mesh.name;
+      result->material     = mesh.material;
+      result->materialList = mesh.materialList;
+      if (numTriangles == 0) return copyOf(mesh);
+
+      const vec3f *sharedNormal =
+        mesh.hasSharedArrays() ? mesh.shared.normal : nullptr;
+      const bool hasNormals =
+        sharedNormal != nullptr || mesh.normal.size() == numVertices;
+      const bool hasColors  = !mesh.hasSharedArrays() &&
+        mesh.color.size() == numVertices;
+      const bool hasTexcoords = mesh.hasSharedArrays()
+        ? mesh.shared.texcoord != nullptr
+        : mesh.texcoord.size() == numVertices;
+      const bool hasMaterialIDs =
+        mesh.triangleMaterialId.size() == numTriangles;
+
+      // ------------------------------------------------------------------
+      // pick a grid cell size: a surface of area A covers about A/h^2
+      // cells of size h, and we want about ratio*numVertices of them
+      // ------------------------------------------------------------------
+      box3f bounds = ospcommon::empty;
+      double area = 0.0;
+      for (size_t i = 0; i < numTriangles; i++) {
+        const Triangle t = triangleOf(mesh, i);
+        const vec3f v0 = positionOf(mesh, t.v0);
+        const vec3f v1 = positionOf(mesh, t.v1);
+        const vec3f v2 = positionOf(mesh, t.v2);
+        bounds.extend(v0);
+        bounds.extend(v1);
+        bounds.extend(v2);
+        area += .5f * length(cross(v1-v0, v2-v0));
+      }
+      const double numCells = std::max(1.0, double(ratio) * numVertices);
+      float cellSize = float(std::sqrt(area / numCells));
+      const vec3f extent = bounds.upper - bounds.lower;
+      const float maxExtent = std::max(extent.x, std::max(extent.y, extent.z));
+      // at most 2^21 cells per axis, so a cell fits into a 64-bit key
+      cellSize = std::max(cellSize, maxExtent / 2097151.f);
+      if (!(cellSize > 0.f)) return copyOf(mesh);
+      const float invCellSize = 1.f / cellSize;
+
+      // ------------------------------------------------------------------
+      // assign vertices to cells (in parallel), then number the cells
+      // ------------------------------------------------------------------
+      std::vector<uint64_t> cellKey(numVertices);
+      parallel_for(int((numVertices + 4095) / 4096), [&](int blockID) {
+        const size_t begin = size_t(blockID) * 4096;
+        const size_t end   = std::min(begin + 4096, numVertices);
+        for (size_t i = begin; i < end; i++) {
+          const vec3f c = (positionOf(mesh, i) - bounds.lower) * invCellSize;
+          const uint64_t x = std::min(uint64_t(c.x), uint64_t(0x1fffff));
+          const uint64_t y = std::min(uint64_t(c.y), uint64_t(0x1fffff));
+          const uint64_t z = std::min(uint64_t(c.z), uint64_t(0x1fffff));
+          cellKey[i] = x | (y << 21) | (z << 42);
+        }
+      });
+
+      std::unordered_map<uint64_t, uint32_t> cellOfKey;
+      cellOfKey.reserve(size_t(numCells * 2));
+      std::vector<uint32_t> cellOf(numVertices);
+      for (size_t i = 0; i < numVertices; i++) {
+        auto it = cellOfKey.find(cellKey[i]);
+        if (it == cellOfKey.end()) {
+          const uint32_t newID = cellOfKey.size();
+          cellOfKey[cellKey[i]] = newID;
+          cellOf[i] = newID;
+        } else
+          cellOf[i] = it->second;
+      }
+      std::vector<uint64_t>().swap(cellKey);
+      std::vector<Cluster> cluster(cellOfKey.size());
+      cellOfKey.clear();
+
+      // ------------------------------------------------------------------
+      // accumulate vertex attributes and the area-weighted quadrics of
+      // all triangles touching each cell
+      // ------------------------------------------------------------------
+      for (size_t i = 0; i < numVertices; i++) {
+        Cluster &c = cluster[cellOf[i]];
+        c.position += positionOf(mesh, i);
+        c.numVertices++;
+        if (hasNormals)
+          c.normal += sharedNormal ? sharedNormal[i] : vec3f(mesh.normal[i]);
+        if (hasColors)
+          c.color += vec3f(mesh.color[i]);
+        if (hasTexcoords)
+          c.texcoord += mesh.hasSharedArrays() ? mesh.shared.texcoord[i]
+                                               : mesh.texcoord[i];
+      }
+
+      std::vector<Triangle> triangle;
+      std::vector<uint32_t> triangleMaterialId;
+      for (size_t i = 0; i < numTriangles; i++) {
+        const Triangle t = triangleOf(mesh, i);
+        const vec3f v0 = positionOf(mesh, t.v0);
+        const vec3f v1 = positionOf(mesh, t.v1);
+        const vec3f v2 = positionOf(mesh, t.v2);
+        const vec3f n  = cross(v1-v0, v2-v0);
+        const float len = length(n);
+        if (len > 0.f) {
+          const vec3f un = n * (1.f/len);
+          const Quadric q(un, -dot(un, v0), .5f*len);
+          cluster[cellOf[t.v0]].quadric += q;
+          cluster[cellOf[t.v1]].quadric += q;
+          cluster[cellOf[t.v2]].quadric += q;
+        }
+
+        // triangles that collapsed into less than three cells go away
+        Triangle s;
+        s.v0 = cellOf[t.v0];
+        s.v1 = cellOf[t.v1];
+        s.v2 = cellOf[t.v2];
+        if (s.v0 == s.v1 || s.v1 == s.v2 || s.v2 == s.v0) continue;
+        triangle.push_back(s);
+        if (hasMaterialIDs)
+          triangleMaterialId.push_back(mesh.triangleMaterialId[i]);
+      }
+
+      // a mesh that is small compared to a cell can collapse entirely;
+      // keep it as it is then, rather than dropping it from the proxy
+      if (triangle.empty())
+        return copyOf(mesh);
+
+      // ------------------------------------------------------------------
+      // one vertex per cell, at the quadric's minimum if that lies
+      // within (about) the cell, else at the vertices' mean
+      // ------------------------------------------------------------------
+      const size_t numClusters = cluster.size();
+      result->position.resize(numClusters);
+      if (hasNormals)   result->normal.resize(numClusters);
+      if (hasColors)    result->color.resize(numClusters);
+      if (hasTexcoords) result->texcoord.resize(numClusters);
+      parallel_for(int(numClusters), [&](int i) {
+        const Cluster &c = cluster[i];
+        const float w = 1.f / c.numVertices;
+        const vec3f mean = c.position * w;
+        vec3f p;
+        if (!c.quadric.minimize(p) || length(p - mean) > cellSize)
+          p = mean;
+        result->position[i] = vec3fa(p);
+        if (hasNormals) {
+          const float len = length(c.normal);
+          result->normal[i] = vec3fa(len > 0.f ? c.normal * (1.f/len)
+                                               : c.normal);
+        }
+        if (hasColors)    result->color[i]    = vec3fa(c.color * w);
+        if (hasTexcoords) result->texcoord[i] = c.texcoord * w;
+      });
+
+      result->triangle.swap(triangle);
+      result->triangleMaterialId.swap(triangleMaterialId);
+      return result;
+    }
+
+    Ref<Model> simplify(const Model &model, float ratio)
+    {
+      Ref<Model> result = new Model;
+      for (size_t i = 0; i < model.instance.size(); i++)
+        result->instance.push_back(model.instance[i]);
+      result->camera   = model.camera;
+      result->mesh.resize(model.mesh.size());
+      parallel_for(int(model.mesh.size()), [&](int meshID) {
+        result->mesh[meshID] = simplify(*model.mesh[meshID], ratio);
+      });
+
+      size_t numTrianglesBefore = 0, numTrianglesAfter = 0;
+      for (size_t i = 0; i < model.mesh.size(); i++) {
+        numTrianglesBefore += model.mesh[i]->numTriangles();
+        numTrianglesAfter  += result->mesh[i]->numTriangles();
+      }
+      cout << "#osp:minisg: simplified " << numTrianglesBefore
+           << " triangles to " << numTrianglesAfter << endl;
+      return result;
+    }
+
+  } // ::ospray::minisg
+} // ::ospray
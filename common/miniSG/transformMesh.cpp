@@ -0,0 +1,95 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+#include "miniSG.h"
+#include "importer.h"
+#include "generateNormals.h"
+// ospcommon
+#include "ospcommon/tasking/parallel_for.h"
+// stl
+#include <cmath>
+#ifdef __SSE__
+#  include <xmmintrin.h>
+#endif
+
+namespace ospray {
+  namespace miniSG {
+
+    /*! out[i] = l*in[i] (+ p, if 'withTranslation'), for 'num' vec3fa's;
+        the w component ends up zero. each vertex is one SIMD register,
+        the matrix columns stay in registers for the whole loop */
+    static void transformVectors(vec3fa *v, size_t num,
+                                 const LinearSpace3f &l, const vec3f &p,
+                                 bool withTranslation)
+    {
+      size_t i = 0;
+#ifdef __SSE__
+      const __m128 cx = _mm_setr_ps(l.vx.x, l.vx.y, l.vx.z, 0.f);
+      const __m128 cy = _mm_setr_ps(l.vy.x, l.vy.y, l.vy.z, 0.f);
+      const __m128 cz = _mm_setr_ps(l.vz.x, l.vz.y, l.vz.z, 0.f);
+      const __m128 cp = withTranslation ? _mm_setr_ps(p.x, p.y, p.z, 0.f)
+                                        : _mm_setzero_ps();
+      for (; i < num; i++) {
+        float *f = (float *)&v[i];
+        const __m128 a = _mm_loadu_ps(f);
+        const __m128 x = _mm_shuffle_ps(a, a, _MM_SHUFFLE(0,0,0,0));
+        const __m128 y = _mm_shuffle_ps(a, a, _MM_SHUFFLE(1,1,1,1));
+        const __m128 z = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2,2,2,2));
+        const __m128 r = _mm_add_ps(_mm_add_ps(cp, _mm_mul_ps(x, cx)),
+                                    _mm_add_ps(_mm_mul_ps(y, cy),
+                                               _mm_mul_ps(z, cz)));
+        _mm_storeu_ps(f, r);
+      }
+#endif
+      for (; i < num; i++) {
+        const vec3f a(v[i].x, v[i].y, v[i].z);
+        const vec3f r = l.vx*a.x + l.vy*a.y + l.vz*a.z;
+        v[i] = vec3fa(withTranslation ? r + p : r);
+      }
+    }
+
+    void transformMesh(Mesh &mesh, const affine3f &xfm)
+    {
+      mesh.materialize();
+
+      // normals transform with the inverse transpose; a singular
+      // transform has no meaningful normals, so leave them as they are
+      const LinearSpace3f &l = xfm.l;
+      const float det = dot(l.vx, cross(l.vy, l.vz));
+      const bool transformNormals = !mesh.normal.empty() && det != 0.f &&
+                                    std::isfinite(det);
+      const LinearSpace3f normalXfm =
+          transformNormals ? l.inverse().transposed() : l;
+
+      const size_t numVertices = mesh.position.size();
+      const size_t numBlocks = numBlocksFor(numVertices, 1<<14);
+      parallel_for(int(numBlocks), [&](int blockID) {
+        const size_t begin = numVertices * blockID / numBlocks;
+        const size_t end   = numVertices * (blockID+1) / numBlocks;
+        transformVectors(&mesh.position[begin], end-begin, l, xfm.p, true);
+        if (transformNormals) {
+          transformVectors(&mesh.normal[begin], end-begin,
+                           normalXfm, vec3f(0.f), false);
+          normalizeNormals(&mesh.normal[begin], end-begin);
+        }
+      });
+
+      mesh.bounds = ospcommon::empty;
+    }
+
+  } // ::ospray::minisg
+} // ::ospray
@@ -0,0 +1,288 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+
+#pragma once
+
+/*! \file NumberParser.h In-place parsing of long, delimiter-separated
+    lists of numbers, as found in (large) xml attributes and contents */
+
+// ospcommon
+#include "ospcommon/tasking/parallel_for.h"
+// stl
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <string>
+#include <type_traits>
+#include <vector>
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+namespace ospray {
+  namespace xml {
+
+    /*! numbers are separated by any mix of whitespace and commas */
+    inline bool isNumberDelimiter(char c)
+    {
+      return (unsigned char)c <= ' ' || c == ',';
+    }
+
+#ifdef __SSE2__
+    /*! bit i is set if s[i] is a delimiter, for the 16 bytes at 's' */
+    inline int numberDelimiterMask(const char *s)
+    {
+      const __m128i space = _mm_set1_epi8(' ');
+      const __m128i comma = _mm_set1_epi8(',');
+      const __m128i c = _mm_loadu_si128((const __m128i *)s);
+      // treat everything <= ' ' (unsigned) as a delimiter
+      const __m128i lessEqualSpace =
+        _mm_cmpeq_epi8(_mm_min_epu8(c, space), c);
+      const __m128i delimiter =
+        _mm_or_si128(lessEqualSpace, _mm_cmpeq_epi8(c, comma));
+      return _mm_movemask_epi8(delimiter);
+    }
+#endif
+
+    /*! advance 's' to the first non-delimiter character in [s,end), or
+        to 'end' if there is none. long runs of delimiters (eg, the
+        indentation of pretty-printed files) get skipped 16 bytes at a
+        time */
+    inline const char *skipNumberDelimiters(const char *s, const char *end)
+    {
+#ifdef __SSE2__
+      while (end - s >= 16) {
+        const int mask = numberDelimiterMask(s);
+        if (mask != 0xffff) {
+          int i = 0;
+          while (mask & (1 << i)) i++;
+          return s + i;
+        }
+        s += 16;
+      }
+#endif
+      while (s < end && isNumberDelimiter(*s)) s++;
+      return s;
+    }
+
+    /*! advance 's' to the first delimiter in [s,end), ie, to the end of
+        the token starting at 's', or to 'end' if there is none; 16
+        bytes at a time, like skipNumberDelimiters() */
+    inline const char *findNumberDelimiter(const char *s, const char *end)
+    {
+#ifdef __SSE2__
+      while (end - s >= 16) {
+        const int mask = numberDelimiterMask(s);
+        if (mask != 0) {
+          int i = 0;
+          while (!(mask & (1 << i))) i++;
+          return s + i;
+        }
+        s += 16;
+      }
+#endif
+      while (s < end && !isNumberDelimiter(*s)) s++;
+      return s;
+    }
+
+    /*! parse an integer starting at 's'; returns the position behind
+        it, or 's' if there is no integer at 's' */
+    template<typename T>
+    inline const char *parseInteger(const char *s, const char *end, T &value)
+    {
+      const char *begin = s;
+      bool negative = false;
+      if (s < end && (*s == '-' || *s == '+')) negative = (*s++ == '-');
+      const char *digits = s;
+      int64_t v = 0;
+      while (s < end && (unsigned)(*s - '0') < 10)
+        v = 10*v + (*s++ - '0');
+      if (s == digits) return begin;
+      value = T(negative ? -v : v);
+      return s;
+    }
+
+    /*! parse a floating point number starting at 's'; returns the
+        position behind it, or 's' if there is no number at 's'. plain
+        decimal numbers are converted exactly without going through
+        strtod(); anything unusual (very long mantissas, huge
+        exponents, inf, nan) falls back to it */
+    template<typename T>
+    inline const char *parseFloat(const char *s, const char *end, T &value)
+    {
+      static const double pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+        1e22
+      };
+
+      const char *begin = s;
+      bool negative = false;
+      if (s < end && (*s == '-' || *s == '+')) negative = (*s++ == '-');
+
+      uint64_t mantissa = 0;
+      int numDigits = 0;
+      int exponent = 0;
+      bool anyDigits = false;
+      // leading zeros don't count towards the 19 digits that fit
+      while (s < end && (unsigned)(*s - '0') < 10) {
+        if (numDigits < 19) {
+          mantissa = 10*mantissa + (*s - '0');
+          if (mantissa) numDigits++;
+        } else
+          exponent++;
+        s++;
+        anyDigits = true;
+      }
+      if (s < end && *s == '.') {
+        s++;
+        while (s < end && (unsigned)(*s - '0') < 10) {
+          if (numDigits < 19) {
+            mantissa = 10*mantissa + (*s - '0');
+            if (mantissa) numDigits++;
+            exponent--;
+          }
+          s++;
+          anyDigits = true;
+        }
+      }
+      if (!anyDigits) {
+        // maybe inf or nan
+        char buf[16];
+        const size_t len = std::min(size_t(end-begin), sizeof(buf)-1);
+        memcpy(buf, begin, len);
+        buf[len] = 0;
+        char *after = buf;
+        const double d = strtod(buf, &after);
+        if (after == buf) return begin;
+        value = T(d);
+        return begin + (after - buf);
+      }
+      if (s < end && (*s == 'e' || *s == 'E')) {
+        int e = 0;
+        const char *afterExp = parseInteger(s+1, end, e);
+        if (afterExp != s+1) {
+          exponent += e;
+          s = afterExp;
+        }
+      }
+
+      double d;
+      if (mantissa < (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+        // both mantissa and power of ten are exact doubles, so a single
+        // multiply/divide gives the correctly rounded result
+        d = exponent < 0
+          ? double(mantissa) / pow10[-exponent]
+          : double(mantissa) * pow10[exponent];
+      } else {
+        // the token isn't necessarily null terminated, so strtod gets a
+        // copy of it (of any length; long mantissas are valid numbers)
+        value = T(strtod(std::string(begin, s).c_str(), nullptr));
+        return s;
+      }
+      value = T(negative ? -d : d);
+      return s;
+    }
+
+    /*! parse all numbers in [begin,end), appending them to 'values';
+        stops at the first token that is not a number. returns the
+        position at which parsing stopped */
+    template<typename T>
+    inline const char *parseNumbers(const char *begin, const char *end,
+                                    std::vector<T> &values)
+    {
+      const char *s = skipNumberDelimiters(begin, end);
+      while (s < end) {
+        T value;
+        const char *next = std::is_integral<T>::value
+          ? parseInteger(s, end, value)
+          : parseFloat(s, end, value);
+        if (next == s) break;
+        values.push_back(value);
+        s = skipNumberDelimiters(next, end);
+      }
+      return s;
+    }
+
+    /*! parse all numbers in [begin,end) like parseNumbers(), but skip
+        over tokens that are not numbers instead of stopping at them.
+        returns the number of tokens skipped */
+    template<typename T>
+    inline size_t parseNumbersSkippingInvalid(const char *begin,
+                                              const char *end,
+                                              std::vector<T> &values)
+    {
+      size_t numSkipped = 0;
+      const char *s = parseNumbers(begin, end, values);
+      while (s < end) {
+        numSkipped++;
+        s = parseNumbers(findNumberDelimiter(s, end), end, values);
+      }
+      return numSkipped;
+    }
+
+    /*! parse a (possibly very long) list of numbers in [begin,end),
+        appending them to 'values' and skipping tokens that are not
+        numbers. lists of more than 'minBlockSize' bytes get split (at
+        delimiters) into blocks that are parsed in parallel. returns the
+        number of tokens skipped */
+    template<typename T>
+    inline size_t parseNumberList(const char *begin, const char *end,
+                                  std::vector<T> &values,
+                                  size_t minBlockSize = 1<<20)
+    {
+      const size_t size = end - begin;
+      const size_t numThreads =
+        std::max(size_t(1), size_t(std::thread::hardware_concurrency()));
+      const size_t numBlocks =
+        std::max(size_t(1), std::min(4*numThreads, size / minBlockSize));
+      if (numBlocks == 1)
+        return parseNumbersSkippingInvalid(begin, end, values);
+
+      std::vector<const char *> split(numBlocks+1);
+      split[0] = begin;
+      split[numBlocks] = end;
+      for (size_t i = 1; i < numBlocks; i++) {
+        const char *s = std::max(begin + size*i/numBlocks, split[i-1]);
+        split[i] = findNumberDelimiter(s, end);
+      }
+
+      std::vector<std::vector<T> > block(numBlocks);
+      std::vector<size_t> numSkipped(numBlocks);
+      ospcommon::parallel_for(int(numBlocks), [&](int blockID) {
+        numSkipped[blockID] =
+          parseNumbersSkippingInvalid(split[blockID], split[blockID+1],
+                                      block[blockID]);
+      });
+
+      size_t numValues = values.size();
+      size_t totalSkipped = 0;
+      for (size_t i = 0; i < numBlocks; i++) {
+        numValues += block[i].size();
+        totalSkipped += numSkipped[i];
+      }
+      values.reserve(numValues);
+      for (size_t i = 0; i < numBlocks; i++)
+        values.insert(values.end(), block[i].begin(), block[i].end());
+      return totalSkipped;
+    }
+
+  } // ::ospray::xml
+} // ::ospray
@@ -15,11 +15,15 @@
 // ======================================================================== //
 
 #include "XML.h"
+#include <algorithm>
 #include <sstream>
 
 namespace ospray {
   namespace xml {
 
+    std::string toString(const int64_t value)
+    { std::stringstream ss; ss << value; return ss.str(); }
+
     std::string toString(const float f)
     { std::stringstream ss; ss << f; return ss.str(); }
 
@@ -161,7 +165,8 @@ namespace ospray {
 
         Prop prop;
         while (parseProp(s,prop)) {
-          node->prop.push_back(new Prop(prop));
+          // values can be huge (eg, vertex arrays), so don't copy them
+          node->prop.push_back(new Prop(std::move(prop)));
           skipWhites(s);
         }
 
@@ -276,6 +281,12 @@ namespace ospray {
     void Writer::openNode(const std::string &type)
     {
       assert(xml);
+      if (!state.empty() && !state.top()->hasContent) {
+        // first child of the open node: finish that node's start tag
+        fprintf(xml,">\n");
+        state.top()->hasContent = true;
+        state.top()->hasChildren = true;
+      }
       spaces(); fprintf(xml,"<%s",type.c_str());
       State *s = new State;
       s->type = type;
@@ -288,12 +299,57 @@ namespace ospray {
       assert(!state.empty());
       State *s = state.top();
       assert(s);
-      if (s->hasContent)
-        fprintf(xml,"</%s>",s->type.c_str());
+      state.pop();
+      if (s->hasChildren) {
+        spaces(); fprintf(xml,"</%s>\n",s->type.c_str());
+      } else if (s->hasContent)
+        fprintf(xml,"</%s>\n",s->type.c_str());
       else
         fprintf(xml,"/>\n");
       delete s;
-      state.pop();
+    }
+
+    void Writer::writeContent(const std::string &name,
+                              const std::string &value)
+    {
+      openNode(name);
+      fprintf(xml,">%s",value.c_str());
+      state.top()->hasContent = true;
+      closeNode();
+    }
+
+    /*! current position in the binary file; 64-bit, since data files
+        easily get larger than 2GB */
+    static size_t binaryPos(FILE *bin)
+    {
+#ifdef _WIN32
+      return size_t(_ftelli64(bin));
+#else
+      return size_t(ftell(bin));
+#endif
+    }
+
+    void Writer::alignData(size_t alignment)
+    {
+      assert(bin);
+      static const char zeros[64] = {0};
+      size_t pos = binaryPos(bin);
+      while (pos % alignment) {
+        const size_t pad = std::min(alignment - pos % alignment,
+                                    sizeof(zeros));
+        fwrite(zeros,1,pad,bin);
+        pos += pad;
+      }
+    }
+
+    size_t Writer::writeData(const void *ptr, size_t size)
+    {
+      assert(bin);
+      const size_t ofs = binaryPos(bin);
+      if (size > 0 && fwrite(ptr,1,size,bin) != size)
+        throw std::runtime_error("ospray::XML error: could not write"
+                                 " binary data");
+      return ofs;
     }
 
     XMLDoc *readXML(const std::string &fn)
@@ -73,6 +73,15 @@ namespace ospray {
         return "";
       }
 
+      /*! find property with given name, and return it, or nullptr if
+          it does not exist. unlike getProp() this does not copy the
+          (possibly very long) value */
+      inline const Prop *findProp(const std::string &name) const {
+        for (size_t i = 0; i < prop.size(); i++)
+          if (prop[i]->name == name) return prop[i];
+        return nullptr;
+      }
+
       /*! find properly with given name, and return as long ('l')
         int. return undefined if prop does not exist */
       inline size_t getPropl(const std::string &name) const
@@ -146,8 +155,9 @@ namespace ospray {
     private:
       struct State {
         bool hasContent;
+        bool hasChildren;
         std::string type;
-        State() : hasContent(false), type("") {};
+        State() : hasContent(false), hasChildren(false), type("") {};
       };
       void spaces();
       std::stack<State*> state;
@@ -0,0 +1,392 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "XMLArena.h"
+// stl
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#ifdef _WIN32
+#  include <cstdio>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace ospray {
+  namespace xml {
+
+    // Arena definitions //////////////////////////////////////////////////////
+
+    Arena::Arena()
+      : m_blockPos(nullptr),
+        m_blockFree(0),
+        m_size(0)
+    {}
+
+    void *Arena::allocate(size_t size)
+    {
+      const size_t alignment = sizeof(void *);
+      size = (size + alignment-1) & ~(alignment-1);
+
+      if (size > m_blockFree) {
+        Block block;
+        block.size = std::max(size, size_t(1)<<20);
+        block.mem.reset(new char[block.size]);
+        m_blockPos  = block.mem.get();
+        m_blockFree = block.size;
+        m_size += block.size;
+        m_blocks.push_back(std::move(block));
+      }
+
+      void *mem = m_blockPos;
+      m_blockPos  += size;
+      m_blockFree -= size;
+      return mem;
+    }
+
+    StringRef Arena::copy(const char *data, size_t length)
+    {
+      char *str = (char *)allocate(length + 1);
+      memcpy(str, data, length);
+      str[length] = 0;
+      return StringRef(str, length);
+    }
+
+    void Arena::clear()
+    {
+      if (m_blocks.empty())
+        return;
+      m_blocks.resize(1);
+      m_blockPos  = m_blocks[0].mem.get();
+      m_blockFree = m_blocks[0].size;
+      m_size      = m_blocks[0].size;
+    }
+
+    // ArenaDoc definitions ///////////////////////////////////////////////////
+
+    ArenaDoc::ArenaDoc(const std::string &fn)
+      : fileName(fn),
+        buffer(nullptr),
+        bufferSize(0),
+        m_mapped(false)
+    {
+#ifdef _WIN32
+      FILE *file = fopen(fn.c_str(), "rb");
+      if (!file) {
+        throw std::runtime_error("ospray::XML error: could not open file '"
+                                 + fn +"'");
+      }
+      _fseeki64(file, 0, SEEK_END);
+      bufferSize = _ftelli64(file);
+      _fseeki64(file, 0, SEEK_SET);
+      buffer = new char[bufferSize+1];
+      buffer[bufferSize] = 0;
+      bufferSize = fread(buffer, 1, bufferSize, file);
+      fclose(file);
+#else
+      int fd = ::open(fn.c_str(), O_RDONLY);
+      if (fd == -1) {
+        throw std::runtime_error("ospray::XML error: could not open file '"
+                                 + fn +"'");
+      }
+
+      struct stat st;
+      fstat(fd, &st);
+      bufferSize = st.st_size;
+
+      if (bufferSize > 0) {
+        // private, writable mapping: string terminators written during
+        // the parse only copy the pages they land in
+        void *mem = mmap(nullptr, bufferSize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE, fd, 0);
+        if (mem == MAP_FAILED) {
+          ::close(fd);
+          throw std::runtime_error("ospray::XML error: could not mmap file '"
+                                   + fn +"'");
+        }
+        buffer = (char *)mem;
+        m_mapped = true;
+      }
+      ::close(fd);
+#endif
+    }
+
+    ArenaDoc::~ArenaDoc()
+    {
+#ifdef _WIN32
+      delete [] buffer;
+#else
+      if (m_mapped)
+        munmap(buffer, bufferSize);
+#endif
+    }
+
+    // In-situ parser /////////////////////////////////////////////////////////
+
+    /*! recursive descent parser over [s,end) of a doc's buffer. all
+        nodes, properties and child lists get allocated in the doc's
+        arena; the only other memory are two scratch stacks that get
+        reused for all nodes */
+    class InSituParser
+    {
+    public:
+      InSituParser(ArenaDoc *doc)
+        : doc(doc),
+          s(doc->buffer),
+          end(doc->buffer + doc->bufferSize)
+      {}
+
+      void parse()
+      {
+        skipWhites();
+        parseHeader();
+        skipWhites();
+
+        const size_t base = childStack.size();
+        while (s < end) {
+          childStack.push_back(parseNode());
+          skipWhites();
+        }
+        doc->child = makeArray(childStack, base);
+
+        terminateStrings(doc);
+      }
+
+    private:
+
+      char peek(size_t i = 0) const { return s+i < end ? s[i] : 0; }
+
+      static bool isWhite(char c)
+      { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+      static bool isIdentifierStart(char c)
+      { return isalpha((unsigned char)c) || c == '_'; }
+
+      static bool isIdentifierChar(char c)
+      {
+        return isalnum((unsigned char)c) || c == '_' ||
+               c == ':' || c == '-' || c == '.';
+      }
+
+      void skipWhites() { while (s < end && isWhite(*s)) ++s; }
+
+      void error(const std::string &what) const
+      {
+        std::stringstream err;
+        err << "error reading XML file '" << doc->fileName.str()
+            << "' at offset " << (s - doc->buffer) << ": " << what;
+        throw std::runtime_error(err.str());
+      }
+
+      void consume(char c)
+      {
+        if (peek() != c)
+          error(std::string("expecting '") + c + "'");
+        ++s;
+      }
+
+      void consume(const char *word)
+      {
+        for (const char *w = word; *w; ++w) {
+          if (peek() != *w)
+            error(std::string("expecting '") + word + "'");
+          ++s;
+        }
+      }
+
+      bool parseIdentifier(StringRef &identifier)
+      {
+        if (!isIdentifierStart(peek()))
+          return false;
+        const char *begin = s;
+        while (s < end && isIdentifierChar(*s)) ++s;
+        identifier = StringRef(begin, s - begin);
+        return true;
+      }
+
+      void parseString(StringRef &value)
+      {
+        const char quote = peek();
+        if (quote != '"' && quote != '\'')
+          error("expecting '\"' or '''");
+        ++s;
+        const char *begin = s;
+        while (s < end && *s != quote) {
+          if (*s == '\\') ++s;
+          ++s;
+        }
+        if (s >= end)
+          error("unterminated property value");
+        value = StringRef(begin, s - begin);
+        ++s;
+      }
+
+      bool parseProp(ArenaProp &prop)
+      {
+        if (!parseIdentifier(prop.name))
+          return false;
+        skipWhites();
+        consume('=');
+        skipWhites();
+        parseString(prop.value);
+        return true;
+      }
+
+      void parseHeader()
+      {
+        if (peek() != '<' || peek(1) != '?')
+          return;
+        consume("<?xml");
+        skipWhites();
+        ArenaProp headerProp;
+        while (parseProp(headerProp)) {
+          // ignore header prop
+          skipWhites();
+        }
+        consume("?>");
+      }
+
+      template<typename T>
+      ArenaArray<T> makeArray(std::vector<T> &stack, size_t base)
+      {
+        ArenaArray<T> array;
+        array.num = stack.size() - base;
+        if (array.num > 0) {
+          array.items = (T *)doc->allocate(array.num * sizeof(T));
+          std::copy(stack.begin() + base, stack.end(), array.items);
+        }
+        stack.resize(base);
+        return array;
+      }
+
+      ArenaNode *parseNode()
+      {
+        consume('<');
+        ArenaNode *node = new (doc->allocate(sizeof(ArenaNode))) ArenaNode;
+        if (!parseIdentifier(node->name))
+          error("could not parse node name");
+
+        skipWhites();
+
+        ArenaProp prop;
+        while (parseProp(prop)) {
+          propStack.push_back(new (doc->allocate(sizeof(ArenaProp)))
+                              ArenaProp(prop));
+          skipWhites();
+        }
+        node->prop = makeArray(propStack, 0);
+
+        if (peek() == '/') {
+          consume("/>");
+          return node;
+        }
+
+        consume('>');
+
+        const size_t base = childStack.size();
+        while (1) {
+          skipWhites();
+          if (s >= end) {
+            std::cout << "#osp:xml: warning: xml file ended with still-open"
+                         " nodes (this typically indicates a partial xml file)"
+                      << std::endl;
+            break;
+          } else if (*s == '<' && peek(1) == '/') {
+            consume("</");
+            StringRef name;
+            parseIdentifier(name);
+            if (name.size() != node->name.size() ||
+                memcmp(name.data, node->name.data, name.size()))
+              error("invalid XML node - started with '<" + node->name.str()
+                    + "...>', but ended with '</" + name.str() + ">'");
+            skipWhites();
+            consume('>');
+            break;
+          } else if (*s == '<') {
+            childStack.push_back(parseNode());
+          } else {
+            if (!node->content.empty())
+              error("invalid XML node - two different contents");
+            const char *begin = s;
+            const char *next = (const char *)memchr(s, '<', end - s);
+            s = next ? (char *)next : end;
+            const char *contentEnd = s;
+            while (contentEnd > begin && isspace((unsigned char)contentEnd[-1]))
+              --contentEnd;
+            node->content = StringRef(begin, contentEnd - begin);
+          }
+        }
+
+        node->child = makeArray(childStack, base);
+        return node;
+      }
+
+      /*! terminate all strings in place; everything right behind a
+          string is syntax that has already been parsed. only a string
+          that ends exactly at the end of the file has no room for its
+          terminator, and gets copied into the arena instead */
+      void terminate(StringRef &str)
+      {
+        if (str.empty()) {
+          str = StringRef();
+          return;
+        }
+        if (str.end() == end) {
+          char *copy = (char *)doc->allocate(str.size() + 1);
+          memcpy(copy, str.data, str.size());
+          copy[str.size()] = 0;
+          str.data = copy;
+          return;
+        }
+        const_cast<char *>(str.end())[0] = 0;
+      }
+
+      void terminateStrings(ArenaNode *node)
+      {
+        terminate(node->name);
+        terminate(node->content);
+        for (ArenaProp *prop : node->prop) {
+          terminate(prop->name);
+          terminate(prop->value);
+        }
+        for (ArenaNode *child : node->child)
+          terminateStrings(child);
+      }
+
+      ArenaDoc *doc;
+      char     *s;
+      char     *end;
+
+      std::vector<ArenaProp *> propStack;
+      std::vector<ArenaNode *> childStack;
+    };
+
+    ArenaDoc *readXMLInSitu(const std::string &fn)
+    {
+      std::unique_ptr<ArenaDoc> doc(new ArenaDoc(fn));
+      InSituParser parser(doc.get());
+      parser.parse();
+      return doc.release();
+    }
+
+  } // ::ospray::xml
+} // ::ospray
@@ -0,0 +1,188 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file XMLArena.h In-situ parsed xml documents: all nodes live in a
+    single arena, and all names, values and contents point straight into
+    the (privately mapped) file, instead of being copied into strings */
+
+#include "XML.h"
+// stl
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ospray {
+  namespace xml {
+
+    /*! a string inside the buffer of an ArenaDoc; not a copy, but a
+        pointer and a length. the string gets terminated in place once
+        the document is parsed, so c_str() is valid as long as the doc */
+    struct StringRef {
+      StringRef() : data(""), length(0) {}
+      StringRef(const char *data, size_t length)
+        : data(data), length(length) {}
+
+      const char *c_str() const { return data; }
+      const char *begin() const { return data; }
+      const char *end()   const { return data + length; }
+      size_t size()       const { return length; }
+      bool   empty()      const { return length == 0; }
+
+      std::string str() const { return std::string(data, length); }
+      operator std::string() const { return str(); }
+
+      bool operator==(const char *s) const
+      { return !strncmp(data, s, length) && s[length] == 0; }
+      bool operator==(const std::string &s) const
+      { return s.size() == length && !memcmp(data, s.data(), length); }
+      template<typename T>
+      bool operator!=(const T &s) const { return !(*this == s); }
+
+      const char *data;
+      size_t      length;
+    };
+
+    inline std::ostream &operator<<(std::ostream &o, const StringRef &str)
+    { return o.write(str.data, str.length); }
+
+    /*! fixed-size array, allocated in a doc's arena */
+    template<typename T>
+    struct ArenaArray {
+      ArenaArray() : items(nullptr), num(0) {}
+
+      size_t size()  const { return num; }
+      bool   empty() const { return num == 0; }
+      T &operator[](size_t i) const { return items[i]; }
+      T *begin() const { return items; }
+      T *end()   const { return items + num; }
+
+      T     *items;
+      size_t num;
+    };
+
+    /*! 'name="value"' property of an ArenaNode */
+    struct ArenaProp {
+      StringRef name;
+      StringRef value;
+    };
+
+    /*! a node of an ArenaDoc. the accessors mirror those of xml::Node,
+        so code written against the heap-allocated DOM ports over by
+        changing the types */
+    struct ArenaNode {
+      inline bool hasProp(const std::string &name) const
+      { return findProp(name) != nullptr; }
+
+      inline std::string getProp(const std::string &name) const
+      {
+        const ArenaProp *p = findProp(name);
+        return p ? p->value.str() : "";
+      }
+
+      /*! find property with given name, and return it, or nullptr if
+          it does not exist */
+      inline const ArenaProp *findProp(const std::string &name) const
+      {
+        for (size_t i = 0; i < prop.size(); i++)
+          if (prop[i]->name == name) return prop[i];
+        return nullptr;
+      }
+
+      /*! find property with given name, and return as long ('l')
+        int. return undefined if prop does not exist */
+      inline size_t getPropl(const std::string &name) const
+      {
+        const ArenaProp *p = findProp(name);
+        return p ? atol(p->value.c_str()) : 0;
+      }
+
+      StringRef               name;
+      StringRef               content;
+      ArenaArray<ArenaProp *> prop;
+      ArenaArray<ArenaNode *> child;
+    };
+
+    /*! bump allocator: hands out memory from large blocks, all of
+        which get freed at once */
+    class OSPRAY_XML_INTERFACE Arena {
+    public:
+      Arena();
+      Arena(const Arena &) = delete;
+      Arena &operator=(const Arena &) = delete;
+
+      /*! allocate 'size' bytes (aligned to pointer size) */
+      void *allocate(size_t size);
+
+      /*! copy the given string into the arena, and terminate it */
+      StringRef copy(const char *data, size_t length);
+
+      /*! free everything allocated so far, but keep the first block
+          around for the next round of allocations */
+      void clear();
+
+      /*! bytes taken by all blocks */
+      size_t size() const { return m_size; }
+
+    private:
+      struct Block {
+        std::unique_ptr<char[]> mem;
+        size_t                  size;
+      };
+      std::vector<Block> m_blocks;
+      char  *m_blockPos;
+      size_t m_blockFree;
+      size_t m_size;
+    };
+
+    /*! an entire in-situ parsed xml document; owns the mapped file and
+        the arena all of its nodes live in. the file is mapped
+        copy-on-write, so the only pages that take memory of their own
+        are those that got a string terminator written into them */
+    struct OSPRAY_XML_INTERFACE ArenaDoc : public ArenaNode {
+      /*! map the given file; throws a std::runtime_error on failure */
+      ArenaDoc(const std::string &fn);
+      ~ArenaDoc();
+
+      /*! allocate 'size' bytes (aligned to pointer size) from the
+          arena; freed with the doc */
+      void *allocate(size_t size) { return m_arena.allocate(size); }
+
+      /*! bytes allocated by the arena, for nodes, properties and child
+          lists */
+      size_t arenaSize() const { return m_arena.size(); }
+
+      //! the name (and path etc) of the file that this doc was read from
+      FileName fileName;
+
+      // the file's content, writable, with 'bufferSize' bytes
+      char   *buffer;
+      size_t  bufferSize;
+
+    private:
+      Arena m_arena;
+      bool  m_mapped;
+    };
+
+    /*! parse an XML file in place, and return a pointer to it. In case
+      of any error, this throws a std::runtime_error exception */
+    OSPRAY_XML_INTERFACE ArenaDoc *readXMLInSitu(const std::string &fn);
+
+  } // ::ospray::xml
+} // ::ospray
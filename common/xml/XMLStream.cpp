@@ -0,0 +1,413 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "XMLStream.h"
+// stl
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace ospray {
+  namespace xml {
+
+    // Stream parser //////////////////////////////////////////////////////////
+
+    /*! reads a file through a buffer that only ever holds the piece
+        being parsed: markup ('<...>') always gets parsed from the buffer
+        as a whole (the buffer grows if a single tag does not fit),
+        while content gets passed on in whatever pieces are in the
+        buffer */
+    class StreamParser
+    {
+    public:
+      StreamParser(const std::string &fn,
+                   StreamHandler &handler,
+                   size_t chunkSize)
+        : fileName(fn),
+          handler(handler),
+          buffer(std::max(chunkSize, size_t(64)) + 1),
+          pos(0),
+          fill(0),
+          offset(0),
+          eof(false)
+      {
+        file = fopen(fn.c_str(), "rb");
+        if (!file) {
+          throw std::runtime_error("ospray::XML error: could not open file '"
+                                   + fn +"'");
+        }
+      }
+
+      ~StreamParser() { fclose(file); }
+
+      void parse()
+      {
+        while (pos < fill || refill()) {
+          if (buffer[pos] != '<') {
+            parseContent();
+            continue;
+          }
+
+          size_t tagEnd = findTagEnd();
+          while (tagEnd == 0) {
+            if (!refill())
+              error("file ended inside of a tag");
+            tagEnd = findTagEnd();
+          }
+          parseMarkup(tagEnd);
+          pos = tagEnd + 1;
+        }
+
+        if (!openNodes.empty()) {
+          std::cout << "#osp:xml: warning: xml file ended with still-open"
+                       " nodes (this typically indicates a partial xml file)"
+                    << std::endl;
+          while (!openNodes.empty()) {
+            const std::string name = openNodes.back();
+            openNodes.pop_back();
+            handler.endElement(StringRef(name.c_str(), name.size()));
+          }
+        }
+      }
+
+    private:
+
+      static bool isWhite(char c)
+      { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+      static bool isIdentifierStart(char c)
+      { return isalpha((unsigned char)c) || c == '_'; }
+
+      static bool isIdentifierChar(char c)
+      {
+        return isalnum((unsigned char)c) || c == '_' ||
+               c == ':' || c == '-' || c == '.';
+      }
+
+      void error(const std::string &what) const
+      {
+        std::stringstream err;
+        err << "error reading XML file '" << fileName
+            << "' at offset " << (offset + pos) << ": " << what;
+        throw std::runtime_error(err.str());
+      }
+
+      /*! move what's left to the front of the buffer, and read as much
+          as fits behind it; returns false if nothing could be read */
+      bool refill()
+      {
+        if (eof)
+          return false;
+
+        if (pos > 0) {
+          memmove(&buffer[0], &buffer[pos], fill - pos);
+          fill   -= pos;
+          offset += pos;
+          pos     = 0;
+        }
+
+        // keep one byte spare, for terminating the last piece of content
+        if (fill == buffer.size() - 1)
+          buffer.resize(2 * buffer.size());
+
+        const size_t numRead =
+          handler.read(file, &buffer[fill], buffer.size() - 1 - fill);
+        if (numRead == 0) {
+          eof = true;
+          return false;
+        }
+        fill += numRead;
+        return true;
+      }
+
+      /*! make sure at least 'n' bytes are in the buffer, if the file
+          has that many left */
+      void require(size_t n)
+      {
+        while (fill - pos < n && refill());
+      }
+
+      bool startsWith(size_t at, const char *s) const
+      {
+        const size_t len = strlen(s);
+        return fill - at >= len && !memcmp(&buffer[at], s, len);
+      }
+
+      /*! index of the end of the given marker, when searching from 'at'
+          on, or 0 if it is not in the buffer (yet) */
+      size_t findMarker(size_t at, const char *marker) const
+      {
+        const size_t len = strlen(marker);
+        for (size_t i = at; i + len <= fill; i++)
+          if (!memcmp(&buffer[i], marker, len))
+            return i + len - 1;
+        return 0;
+      }
+
+      /*! index of the '>' that closes the markup starting at 'pos', or
+          0 if the buffer does not contain the whole markup yet */
+      size_t findTagEnd()
+      {
+        require(9);
+        if (startsWith(pos, "<!--"))
+          return findMarker(pos + 4, "-->");
+        if (startsWith(pos, "<![CDATA["))
+          return findMarker(pos + 9, "]]>");
+        if (startsWith(pos, "<?"))
+          return findMarker(pos + 2, "?>");
+
+        char quote = 0;
+        for (size_t i = pos + 1; i < fill; i++) {
+          const char c = buffer[i];
+          if (quote) {
+            if (c == '\\') ++i;
+            else if (c == quote) quote = 0;
+          } else if (c == '"' || c == '\'') {
+            quote = c;
+          } else if (c == '>') {
+            return i;
+          }
+        }
+        return 0;
+      }
+
+      /*! pass on the content up to the next '<', or to the end of the
+          buffer */
+      void parseContent()
+      {
+        const char *begin = &buffer[pos];
+        const char *next  = (const char *)memchr(begin, '<', fill - pos);
+        const size_t end  = next ? next - &buffer[0] : fill;
+
+        if (!openNodes.empty()) {
+          // the byte behind the content is either the next '<' or the
+          // spare one, so it can be swapped for a terminator
+          const char saved = buffer[end];
+          buffer[end] = 0;
+          handler.content(StringRef(begin, end - pos));
+          buffer[end] = saved;
+        }
+        pos = end;
+      }
+
+      void parseMarkup(size_t tagEnd)
+      {
+        char *s   = &buffer[pos];
+        char *end = &buffer[tagEnd];
+
+        if (startsWith(pos, "<!--") || startsWith(pos, "<?"))
+          return;
+
+        if (startsWith(pos, "<![CDATA[")) {
+          if (!openNodes.empty()) {
+            *(end - 2) = 0;
+            handler.content(StringRef(s + 9, (end - 2) - (s + 9)));
+          }
+          return;
+        }
+
+        if (s[1] == '!')
+          // doctype and the like
+          return;
+
+        if (s[1] == '/') {
+          s += 2;
+          const char *name = s;
+          while (s < end && isIdentifierChar(*s)) ++s;
+          const size_t length = s - name;
+          if (openNodes.empty())
+            error("closing tag without any open node");
+          const std::string &open = openNodes.back();
+          if (open.size() != length || memcmp(open.data(), name, length))
+            error("invalid XML node - started with '<" + open
+                  + "...>', but ended with '</" + std::string(name, length)
+                  + ">'");
+          *s = 0;
+          handler.endElement(StringRef(name, length));
+          openNodes.pop_back();
+          return;
+        }
+
+        // start tag: find all strings first, and only terminate them
+        // (which overwrites the syntax right behind them) at the end
+        ++s;
+        if (!isIdentifierStart(*s))
+          error("could not parse node name");
+        const char *name = s;
+        while (s < end && isIdentifierChar(*s)) ++s;
+        const StringRef nodeName(name, s - name);
+
+        prop.clear();
+        while (1) {
+          while (s < end && isWhite(*s)) ++s;
+          if (s == end || *s == '/')
+            break;
+          if (!isIdentifierStart(*s))
+            error("could not parse property name");
+          ArenaProp p;
+          const char *propName = s;
+          while (s < end && isIdentifierChar(*s)) ++s;
+          p.name = StringRef(propName, s - propName);
+          while (s < end && isWhite(*s)) ++s;
+          if (*s != '=')
+            error("expecting '='");
+          ++s;
+          while (s < end && isWhite(*s)) ++s;
+          const char quote = *s;
+          if (quote != '"' && quote != '\'')
+            error("expecting '\"' or '''");
+          const char *value = ++s;
+          while (s < end && *s != quote) {
+            if (*s == '\\') ++s;
+            ++s;
+          }
+          p.value = StringRef(value, s - value);
+          ++s;
+          prop.push_back(p);
+        }
+        const bool selfClosing = (*s == '/');
+
+        const_cast<char *>(nodeName.end())[0] = 0;
+        for (const ArenaProp &p : prop) {
+          const_cast<char *>(p.name.end())[0]  = 0;
+          const_cast<char *>(p.value.end())[0] = 0;
+        }
+
+        openNodes.push_back(nodeName.str());
+        handler.startElement(nodeName, prop);
+        if (selfClosing) {
+          handler.endElement(nodeName);
+          openNodes.pop_back();
+        }
+      }
+
+      std::string    fileName;
+      StreamHandler &handler;
+      FILE          *file;
+
+      // [pos,fill) of the buffer is what has been read but not parsed
+      // yet; 'offset' is where the buffer starts in the file
+      std::vector<char> buffer;
+      size_t pos;
+      size_t fill;
+      size_t offset;
+      bool   eof;
+
+      std::vector<std::string> openNodes;
+      std::vector<ArenaProp>   prop;
+    };
+
+    void parseXMLStream(const std::string &fn,
+                        StreamHandler &handler,
+                        size_t chunkSize)
+    {
+      StreamParser parser(fn, handler, chunkSize);
+      parser.parse();
+    }
+
+    // SubtreeReader definitions //////////////////////////////////////////////
+
+    SubtreeReader::SubtreeReader(int depth)
+      : m_depth(depth),
+        m_numOpen(0)
+    {}
+
+    void SubtreeReader::startElement(const StringRef &name,
+                                     const std::vector<ArenaProp> &prop)
+    {
+      if (m_numOpen < m_depth) {
+        m_numOpen++;
+        enclosingElement(name, prop);
+        return;
+      }
+
+      const size_t level = m_numOpen++ - m_depth;
+      if (m_open.size() <= level)
+        m_open.resize(level + 1);
+
+      ArenaNode *node =
+        new (m_arena.allocate(sizeof(ArenaNode))) ArenaNode;
+      node->name = m_arena.copy(name.data, name.size());
+      for (const ArenaProp &p : prop) {
+        ArenaProp *copy = new (m_arena.allocate(sizeof(ArenaProp))) ArenaProp;
+        copy->name  = m_arena.copy(p.name.data, p.name.size());
+        copy->value = m_arena.copy(p.value.data, p.value.size());
+        m_propStack.push_back(copy);
+      }
+      if (!m_propStack.empty()) {
+        node->prop.num   = m_propStack.size();
+        node->prop.items = (ArenaProp **)
+          m_arena.allocate(node->prop.num * sizeof(ArenaProp *));
+        std::copy(m_propStack.begin(), m_propStack.end(), node->prop.items);
+        m_propStack.clear();
+      }
+
+      OpenNode &open = m_open[level];
+      open.node      = node;
+      open.childBase = m_childStack.size();
+      open.content.clear();
+    }
+
+    void SubtreeReader::content(const StringRef &piece)
+    {
+      if (m_numOpen > m_depth)
+        m_open[m_numOpen - m_depth - 1].content.append(piece.data,
+                                                       piece.size());
+    }
+
+    void SubtreeReader::endElement(const StringRef &name)
+    {
+      if (--m_numOpen < m_depth)
+        return;
+
+      const size_t level = m_numOpen - m_depth;
+      OpenNode &open = m_open[level];
+      ArenaNode *node = open.node;
+
+      // same as the in-situ parser: content without surrounding white
+      // space, and white space between child nodes dropped
+      const std::string &content = open.content;
+      size_t begin = 0, end = content.size();
+      while (begin < end && isspace((unsigned char)content[begin])) ++begin;
+      while (end > begin && isspace((unsigned char)content[end-1])) --end;
+      if (begin < end)
+        node->content = m_arena.copy(content.data() + begin, end - begin);
+
+      const size_t numChildren = m_childStack.size() - open.childBase;
+      if (numChildren > 0) {
+        node->child.num   = numChildren;
+        node->child.items = (ArenaNode **)
+          m_arena.allocate(numChildren * sizeof(ArenaNode *));
+        std::copy(m_childStack.begin() + open.childBase, m_childStack.end(),
+                  node->child.items);
+        m_childStack.resize(open.childBase);
+      }
+
+      if (level > 0) {
+        m_childStack.push_back(node);
+        return;
+      }
+
+      subtree(node);
+      m_arena.clear();
+    }
+
+  } // ::ospray::xml
+} // ::ospray
@@ -0,0 +1,103 @@
+// ======================================================================== //
+// Copyright 2009-2016 Intel Corporation                                    //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+/*! \file XMLStream.h Event based ("SAX style") reading of xml files that
+    are too large to be held in memory as a whole: the file gets read in
+    chunks, and a handler gets told about every element start, piece of
+    content, and element end as soon as the parser gets to it */
+
+#include "XMLArena.h"
+// stl
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace ospray {
+  namespace xml {
+
+    /*! receives the events of parseXMLStream(). all strings passed to
+        it are terminated, but only valid for the duration of the call */
+    struct OSPRAY_XML_INTERFACE StreamHandler {
+      virtual ~StreamHandler() {}
+
+      /*! an element got opened */
+      virtual void startElement(const StringRef &name,
+                                const std::vector<ArenaProp> &prop) = 0;
+
+      /*! a piece of the content of the innermost open element. long
+          contents arrive in several pieces, which may split a token
+          anywhere; white space gets passed on as is */
+      virtual void content(const StringRef &piece) {}
+
+      /*! the innermost open element got closed */
+      virtual void endElement(const StringRef &name) = 0;
+
+      /*! read the next (up to) 'size' bytes of the file; a handler can
+          override this to wrap the reads, eg to limit how many files
+          get read at once */
+      virtual size_t read(FILE *file, char *buffer, size_t size)
+      { return fread(buffer, 1, size, file); }
+    };
+
+    /*! read the given file in pieces of (about) 'chunkSize' bytes, and
+        pass everything found in it to the handler. in case of any
+        error this throws a std::runtime_error exception */
+    OSPRAY_XML_INTERFACE void parseXMLStream(const std::string &fn,
+                                             StreamHandler &handler,
+                                             size_t chunkSize = 1<<20);
+
+    /*! stream handler that assembles each element at a given depth, along
+        with everything below it, into an ArenaNode, hands that to
+        subtree(), and then throws it away again; a file with many
+        top-level entries thus gets processed one entry at a time, with
+        no more than one of them in memory */
+    class OSPRAY_XML_INTERFACE SubtreeReader : public StreamHandler {
+    public:
+      SubtreeReader(int depth = 1);
+
+      void startElement(const StringRef &name,
+                        const std::vector<ArenaProp> &prop) override;
+      void content(const StringRef &piece) override;
+      void endElement(const StringRef &name) override;
+
+    protected:
+      /*! called once for each element at the given depth, when it got
+          closed; 'node' is only valid for the duration of the call */
+      virtual void subtree(ArenaNode *node) = 0;
+
+      /*! called for each element opened above the given depth */
+      virtual void enclosingElement(const StringRef &name,
+                                    const std::vector<ArenaProp> &prop) {}
+
+    private:
+      struct OpenNode {
+        ArenaNode  *node;
+        std::string content;
+        size_t      childBase;
+      };
+
+      int   m_depth;
+      int   m_numOpen;
+      Arena m_arena;
+      std::vector<OpenNode>    m_open;
+      std::vector<ArenaNode *> m_childStack;
+      std::vector<ArenaProp *> m_propStack;
+    };
+
+  } // ::ospray::xml
+} // ::ospray